@@ -5,6 +5,13 @@
 //  - parList: is accessed in modelBase constructor (top of hierarchy) to collect vector of model parameters.
 //  - Messages and needStop: can be used in any (helper) function finding errors. When functions not immediately
 //    throw an exception, higher level code should check needStop and throw an exception.
+//  - rng: the random number generator of the chain running in this thread (see rbayzRNG.h and mcmcChain.h);
+//    it is thread_local, every thread running a chain sets it to the generator of its own chain.
+//  - chainTag: set while building a chain to add the chain number in names of output files.
+//  - resumeRun: set when resuming from a checkpoint, then existing samples files are not overwritten.
+//  - modelEnv: the environment of the model formula, variables not in the data are searched from there
+//    (and its enclosing environments, as R does for a formula). It is reset to the global environment
+//    when rbayz_cpp returns, so the caller's frame is not kept alive after the run.
 
 
 #ifndef Rbayz_h
@@ -12,6 +19,7 @@
 
 #include <Rcpp.h>
 #include "parVector.h"
+#include "rbayzRNG.h"
 
 namespace Rbayz {
    extern std::vector<parVector**> parList;
@@ -19,6 +27,10 @@ namespace Rbayz {
    extern bool needStop;
    extern Rcpp::DataFrame mainData;
    extern Rcpp::IntegerVector RunInfo;
+   extern thread_local rbayzRNG* rng;
+   extern std::string chainTag;
+   extern bool resumeRun;
+   extern Rcpp::Environment modelEnv;
 }
 
 #endif /* Rbayz_h */
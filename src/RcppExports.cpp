@@ -11,8 +11,8 @@ Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
 // rbayz_cpp
-Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputData, Rcpp::IntegerVector chain, SEXP methodArg, int verbose, Rcpp::Nullable<Rcpp::List> initVals_);
-RcppExport SEXP _Rbayz_rbayz_cpp(SEXP modelFormulaSEXP, SEXP VESEXP, SEXP inputDataSEXP, SEXP chainSEXP, SEXP methodArgSEXP, SEXP verboseSEXP, SEXP initVals_SEXP) {
+Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputData, Rcpp::IntegerVector chain, SEXP methodArg, int verbose, int nchains, int checkpoint, bool resume, double target_ess, double target_mcse, bool trace_float, double trace_limit, bool joint_fixed, Rcpp::Nullable<Rcpp::List> initVals_);
+RcppExport SEXP _Rbayz_rbayz_cpp(SEXP modelFormulaSEXP, SEXP VESEXP, SEXP inputDataSEXP, SEXP chainSEXP, SEXP methodArgSEXP, SEXP verboseSEXP, SEXP nchainsSEXP, SEXP checkpointSEXP, SEXP resumeSEXP, SEXP target_essSEXP, SEXP target_mcseSEXP, SEXP trace_floatSEXP, SEXP trace_limitSEXP, SEXP joint_fixedSEXP, SEXP initVals_SEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -22,14 +22,22 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type chain(chainSEXP);
     Rcpp::traits::input_parameter< SEXP >::type methodArg(methodArgSEXP);
     Rcpp::traits::input_parameter< int >::type verbose(verboseSEXP);
+    Rcpp::traits::input_parameter< int >::type nchains(nchainsSEXP);
+    Rcpp::traits::input_parameter< int >::type checkpoint(checkpointSEXP);
+    Rcpp::traits::input_parameter< bool >::type resume(resumeSEXP);
+    Rcpp::traits::input_parameter< double >::type target_ess(target_essSEXP);
+    Rcpp::traits::input_parameter< double >::type target_mcse(target_mcseSEXP);
+    Rcpp::traits::input_parameter< bool >::type trace_float(trace_floatSEXP);
+    Rcpp::traits::input_parameter< double >::type trace_limit(trace_limitSEXP);
+    Rcpp::traits::input_parameter< bool >::type joint_fixed(joint_fixedSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::List> >::type initVals_(initVals_SEXP);
-    rcpp_result_gen = Rcpp::wrap(rbayz_cpp(modelFormula, VE, inputData, chain, methodArg, verbose, initVals_));
+    rcpp_result_gen = Rcpp::wrap(rbayz_cpp(modelFormula, VE, inputData, chain, methodArg, verbose, nchains, checkpoint, resume, target_ess, target_mcse, trace_float, trace_limit, joint_fixed, initVals_));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_Rbayz_rbayz_cpp", (DL_FUNC) &_Rbayz_rbayz_cpp, 7},
+    {"_Rbayz_rbayz_cpp", (DL_FUNC) &_Rbayz_rbayz_cpp, 15},
     {NULL, NULL, 0}
 };
 
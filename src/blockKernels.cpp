@@ -0,0 +1,53 @@
+//
+//  blockKernels.cpp
+//
+
+#define USE_FC_LEN_T
+#include <R_ext/BLAS.h>
+#include <R_ext/Lapack.h>
+#ifndef FCONE
+#define FCONE
+#endif
+#include "blockKernels.h"
+
+void blockCrossprod(const double* Z, int n, int b, const double* zr, double* C, double* Zzr) {
+   double one=1.0, zero=0.0;
+   int inc=1;
+   F77_CALL(dsyrk)("L", "T", &b, &n, &one, Z, &n, &zero, C, &b FCONE FCONE);
+   F77_CALL(dgemv)("T", &n, &b, &one, Z, &n, zr, &inc, &zero, Zzr, &inc FCONE);
+}
+
+void blockCrossprodAdd(const double* Z, int n, int b, double* C) {
+   double one=1.0;
+   F77_CALL(dsyrk)("L", "T", &b, &n, &one, Z, &n, &one, C, &b FCONE FCONE);
+}
+
+bool blockCholSolve(double* C, int b, double* rhs) {
+   int info=0, nrhs=1;
+   F77_CALL(dpotrf)("L", &b, C, &b, &info FCONE);
+   if(info != 0) return false;
+   F77_CALL(dpotrs)("L", &b, &nrhs, C, &b, rhs, &b, &info FCONE);
+   return (info == 0);
+}
+
+bool blockChol(double* C, int b) {
+   int info=0;
+   F77_CALL(dpotrf)("L", &b, C, &b, &info FCONE);
+   return (info == 0);
+}
+
+void blockCholForwardSolve(const double* L, int b, double* z) {
+   int inc=1;
+   F77_CALL(dtrsv)("L", "N", "N", &b, L, &b, z, &inc FCONE FCONE FCONE);
+}
+
+void blockCholBackSolve(const double* L, int b, double* z) {
+   int inc=1;
+   F77_CALL(dtrsv)("L", "T", "N", &b, L, &b, z, &inc FCONE FCONE FCONE);
+}
+
+void blockAxpy(const double* X, int n, int b, const double* delta, double* resid) {
+   double minusone=-1.0, one=1.0;
+   int inc=1;
+   F77_CALL(dgemv)("N", &n, &b, &minusone, X, &n, delta, &inc, &one, resid, &inc FCONE);
+}
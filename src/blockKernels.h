@@ -0,0 +1,26 @@
+//
+//  blockKernels.h
+//  Dense linear algebra for block updates of covariate columns (rr() with the block option), using
+//  the BLAS and LAPACK that R is linked to. Matrices are column-major with n rows (observations or
+//  matrix rows) and b columns, the b x b matrices are symmetric with the lower triangle used.
+//   - blockCrossprod: C = Z'Z and zr' = Z'zr, Z are the covariates scaled by sqrt(weights)
+//   - blockCrossprodAdd: C += Z'Z, to build a crossproduct from chunks of rows
+//   - blockCholSolve: Cholesky factor of C (in place, lower triangle) and solve C m = rhs (in place)
+//   - blockChol: Cholesky factor of C only (in place, lower triangle)
+//   - blockCholForwardSolve: z = L^-1 z
+//   - blockCholBackSolve: z = L^-T z, turns N(0,I) deviates in deviates with covariance C^-1
+//   - blockAxpy: resid -= X delta
+//
+
+#ifndef blockKernels_h
+#define blockKernels_h
+
+void blockCrossprod(const double* Z, int n, int b, const double* zr, double* C, double* Zzr);
+void blockCrossprodAdd(const double* Z, int n, int b, double* C);
+bool blockCholSolve(double* C, int b, double* rhs);
+bool blockChol(double* C, int b);
+void blockCholForwardSolve(const double* L, int b, double* z);
+void blockCholBackSolve(const double* L, int b, double* z);
+void blockAxpy(const double* X, int n, int b, const double* delta, double* resid);
+
+#endif /* blockKernels_h */
@@ -0,0 +1,72 @@
+//
+//  checkpointTools.h
+//  Binary read and write of state for checkpoint files (see mcmcChain::saveCheckpoint).
+//  Vectors are written with their size in front, reading checks that the size is the same
+//  as the vector in the model being resumed, so that a checkpoint from another model gives
+//  an error instead of garbage.
+//  fileSeek and fileTell use 64-bit file offsets also on Windows, where long (and so fseek and
+//  ftell) is 32 bits; used for the trace and samples files that can be larger than 2GB.
+//
+
+#ifndef checkpointTools_h
+#define checkpointTools_h
+
+#include <stdio.h>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+#include "rbayzExceptions.h"
+
+inline int fileSeek(FILE* f, int64_t offset, int origin) {
+#ifdef _WIN32
+   return _fseeki64(f, offset, origin);
+#else
+   return fseeko(f, off_t(offset), origin);
+#endif
+}
+
+inline int64_t fileTell(FILE* f) {
+#ifdef _WIN32
+   return int64_t(_ftelli64(f));
+#else
+   return int64_t(ftello(f));
+#endif
+}
+
+template <typename T> void writeState(FILE* f, const T* x, size_t n) {
+   if(n > 0 && fwrite(x, sizeof(T), n, f) != n)
+      throw generalRbayzError("Error writing checkpoint file");
+}
+
+template <typename T> void readState(FILE* f, T* x, size_t n) {
+   if(n > 0 && fread(x, sizeof(T), n, f) != n)
+      throw generalRbayzError("Error reading checkpoint file: file is truncated or damaged");
+}
+
+template <typename T> void writeStateVector(FILE* f, const T* x, size_t n) {
+   writeState(f, &n, 1);
+   writeState(f, x, n);
+}
+
+template <typename T> void readStateVector(FILE* f, T* x, size_t n, std::string what) {
+   size_t nfile;
+   readState(f, &nfile, 1);
+   if(nfile != n)
+      throw generalRbayzError("Checkpoint file does not match the model: size of " + what + " is different");
+   readState(f, x, n);
+}
+
+inline void writeStateString(FILE* f, const std::string & s) {
+   writeStateVector(f, s.c_str(), s.size());
+}
+
+inline std::string readStateString(FILE* f) {
+   size_t n;
+   readState(f, &n, 1);
+   if(n > 100000) throw generalRbayzError("Error reading checkpoint file: file is damaged");
+   std::string s(n, ' ');
+   if(n > 0) readState(f, &s[0], n);
+   return s;
+}
+
+#endif /* checkpointTools_h */
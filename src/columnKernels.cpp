@@ -0,0 +1,240 @@
+//
+//  columnKernels.cpp
+//
+
+#include "columnKernels.h"
+
+#if defined(__x86_64__) && defined(__linux__) && (defined(__GNUC__) || defined(__clang__))
+#define RBAYZ_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#ifdef RBAYZ_X86_KERNELS
+
+// The vector versions process 4 (AVX2) or 8 (AVX-512) observations at a time, using a gather
+// when there is an index, the remaining observations use the plain loop.
+// The AVX-512 versions use the masked gather and reduce the sums through memory, because the
+// unmasked gather and _mm512_reduce_add_pd give -Wuninitialized warnings with GCC 12.
+
+template<bool indexed, bool weighted>
+__attribute__((target("avx2,fma")))
+void columnDotAVX2(const double* col, const size_t* index, double center, const double* resid,
+                   const double* weights, size_t n, double & xr, double & xx, bool needXX) {
+   __m256d vcenter = _mm256_set1_pd(center);
+   __m256d sxr = _mm256_setzero_pd(), sxx = _mm256_setzero_pd();
+   size_t i=0;
+   for(; i+4 <= n; i+=4) {
+      __m256d x = indexed ? _mm256_i64gather_pd(col, _mm256_loadu_si256((const __m256i*)(index+i)), 8)
+                          : _mm256_loadu_pd(col+i);
+      x = _mm256_sub_pd(x, vcenter);
+      __m256d xw = weighted ? _mm256_mul_pd(x, _mm256_loadu_pd(weights+i)) : x;
+      sxr = _mm256_fmadd_pd(xw, _mm256_loadu_pd(resid+i), sxr);
+      if(needXX) sxx = _mm256_fmadd_pd(xw, x, sxx);
+   }
+   double t[4];
+   _mm256_storeu_pd(t, sxr);
+   double sumxr = (t[0]+t[1]) + (t[2]+t[3]);
+   _mm256_storeu_pd(t, sxx);
+   double sumxx = (t[0]+t[1]) + (t[2]+t[3]);
+   double tailxr, tailxx;
+   columnDotScalar(indexed ? col : col+i, indexed ? index+i : 0, center, resid+i, weighted ? weights+i : 0,
+                   n-i, tailxr, tailxx, needXX);
+   xr = sumxr + tailxr;
+   xx = sumxx + tailxx;
+}
+
+template<bool indexed>
+__attribute__((target("avx2,fma")))
+void columnAxpyAVX2(const double* col, const size_t* index, double center, double a, double* resid, size_t n) {
+   __m256d vcenter = _mm256_set1_pd(center);
+   __m256d va = _mm256_set1_pd(a);
+   size_t i=0;
+   for(; i+4 <= n; i+=4) {
+      __m256d x = indexed ? _mm256_i64gather_pd(col, _mm256_loadu_si256((const __m256i*)(index+i)), 8)
+                          : _mm256_loadu_pd(col+i);
+      x = _mm256_sub_pd(x, vcenter);
+      _mm256_storeu_pd(resid+i, _mm256_fnmadd_pd(va, x, _mm256_loadu_pd(resid+i)));
+   }
+   columnAxpyScalar(indexed ? col : col+i, indexed ? index+i : 0, center, a, resid+i, n-i);
+}
+
+template<bool indexed, bool weighted>
+__attribute__((target("avx512f")))
+void columnDotAVX512(const double* col, const size_t* index, double center, const double* resid,
+                     const double* weights, size_t n, double & xr, double & xx, bool needXX) {
+   __m512d vcenter = _mm512_set1_pd(center);
+   __m512d sxr = _mm512_setzero_pd(), sxx = _mm512_setzero_pd();
+   size_t i=0;
+   for(; i+8 <= n; i+=8) {
+      __m512d x = indexed ? _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF,
+                                                     _mm512_loadu_si512((const void*)(index+i)), col, 8)
+                          : _mm512_loadu_pd(col+i);
+      x = _mm512_sub_pd(x, vcenter);
+      __m512d xw = weighted ? _mm512_mul_pd(x, _mm512_loadu_pd(weights+i)) : x;
+      sxr = _mm512_fmadd_pd(xw, _mm512_loadu_pd(resid+i), sxr);
+      if(needXX) sxx = _mm512_fmadd_pd(xw, x, sxx);
+   }
+   double t[8];
+   _mm512_storeu_pd(t, sxr);
+   double sumxr = ((t[0]+t[1]) + (t[2]+t[3])) + ((t[4]+t[5]) + (t[6]+t[7]));
+   _mm512_storeu_pd(t, sxx);
+   double sumxx = ((t[0]+t[1]) + (t[2]+t[3])) + ((t[4]+t[5]) + (t[6]+t[7]));
+   double tailxr, tailxx;
+   columnDotScalar(indexed ? col : col+i, indexed ? index+i : 0, center, resid+i, weighted ? weights+i : 0,
+                   n-i, tailxr, tailxx, needXX);
+   xr = sumxr + tailxr;
+   xx = sumxx + tailxx;
+}
+
+template<bool indexed>
+__attribute__((target("avx512f")))
+void columnAxpyAVX512(const double* col, const size_t* index, double center, double a, double* resid, size_t n) {
+   __m512d vcenter = _mm512_set1_pd(center);
+   __m512d va = _mm512_set1_pd(a);
+   size_t i=0;
+   for(; i+8 <= n; i+=8) {
+      __m512d x = indexed ? _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF,
+                                                     _mm512_loadu_si512((const void*)(index+i)), col, 8)
+                          : _mm512_loadu_pd(col+i);
+      x = _mm512_sub_pd(x, vcenter);
+      _mm512_storeu_pd(resid+i, _mm512_fnmadd_pd(va, x, _mm512_loadu_pd(resid+i)));
+   }
+   columnAxpyScalar(indexed ? col : col+i, indexed ? index+i : 0, center, a, resid+i, n-i);
+}
+
+static int detectKernelLevel() {
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx512f")) return 2;
+   if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return 1;
+   return 0;
+}
+
+int columnKernelLevel() {
+   static int level = detectKernelLevel();
+   return level;
+}
+
+void columnDot(const double* col, const size_t* index, double center, const double* resid,
+               const double* weights, size_t n, double & xr, double & xx, bool needXX) {
+   int level = columnKernelLevel();
+   if(level==2) {
+      if(index != 0) {
+         if(weights != 0) columnDotAVX512<true,true>(col, index, center, resid, weights, n, xr, xx, needXX);
+         else columnDotAVX512<true,false>(col, index, center, resid, weights, n, xr, xx, needXX);
+      }
+      else {
+         if(weights != 0) columnDotAVX512<false,true>(col, index, center, resid, weights, n, xr, xx, needXX);
+         else columnDotAVX512<false,false>(col, index, center, resid, weights, n, xr, xx, needXX);
+      }
+   }
+   else if(level==1) {
+      if(index != 0) {
+         if(weights != 0) columnDotAVX2<true,true>(col, index, center, resid, weights, n, xr, xx, needXX);
+         else columnDotAVX2<true,false>(col, index, center, resid, weights, n, xr, xx, needXX);
+      }
+      else {
+         if(weights != 0) columnDotAVX2<false,true>(col, index, center, resid, weights, n, xr, xx, needXX);
+         else columnDotAVX2<false,false>(col, index, center, resid, weights, n, xr, xx, needXX);
+      }
+   }
+   else columnDotScalar(col, index, center, resid, weights, n, xr, xx, needXX);
+}
+
+void columnAxpy(const double* col, const size_t* index, double center, double a, double* resid, size_t n) {
+   int level = columnKernelLevel();
+   if(level==2) {
+      if(index != 0) columnAxpyAVX512<true>(col, index, center, a, resid, n);
+      else columnAxpyAVX512<false>(col, index, center, a, resid, n);
+   }
+   else if(level==1) {
+      if(index != 0) columnAxpyAVX2<true>(col, index, center, a, resid, n);
+      else columnAxpyAVX2<false>(col, index, center, a, resid, n);
+   }
+   else columnAxpyScalar(col, index, center, a, resid, n);
+}
+
+#else
+
+int columnKernelLevel() {
+   return 0;
+}
+
+void columnDot(const double* col, const size_t* index, double center, const double* resid,
+               const double* weights, size_t n, double & xr, double & xx, bool needXX) {
+   columnDotScalar(col, index, center, resid, weights, n, xr, xx, needXX);
+}
+
+void columnAxpy(const double* col, const size_t* index, double center, double a, double* resid, size_t n) {
+   columnAxpyScalar(col, index, center, a, resid, n);
+}
+
+#endif
+
+// Packed columns: the 4 centered values are computed once per call, rows before the first whole
+// byte and after the last one are done one at a time.
+void packedDot(packedColumn col, size_t first, const size_t* index, double center, const double* resid,
+               const double* weights, size_t n, double & xr, double & xx, bool needXX) {
+   double ct[4] = {col.table[0]-center, col.table[1]-center, col.table[2]-center, col.table[3]-center};
+   double sxr=0.0l, sxx=0.0l, x, xw;
+   size_t i=0;
+   if(index != 0) {
+      for(; i<n; i++) {
+         x = ct[(col.g[index[i]>>2] >> ((index[i] & 3) << 1)) & 3];
+         xw = (weights==0) ? x : x*weights[i];
+         sxr += xw * resid[i];
+         if(needXX) sxx += xw * x;
+      }
+   }
+   else {
+      size_t row = first;
+      for(; i<n && (row & 3) != 0; i++, row++) {
+         x = ct[(col.g[row>>2] >> ((row & 3) << 1)) & 3];
+         xw = (weights==0) ? x : x*weights[i];
+         sxr += xw * resid[i];
+         if(needXX) sxx += xw * x;
+      }
+      double x4[4];
+      for(; i+4 <= n; i+=4, row+=4) {
+         unsigned char byte = col.g[row>>2];
+         x4[0] = ct[byte & 3];
+         x4[1] = ct[(byte >> 2) & 3];
+         x4[2] = ct[(byte >> 4) & 3];
+         x4[3] = ct[byte >> 6];
+         for(int k=0; k<4; k++) {
+            xw = (weights==0) ? x4[k] : x4[k]*weights[i+k];
+            sxr += xw * resid[i+k];
+            if(needXX) sxx += xw * x4[k];
+         }
+      }
+      for(; i<n; i++, row++) {
+         x = ct[(col.g[row>>2] >> ((row & 3) << 1)) & 3];
+         xw = (weights==0) ? x : x*weights[i];
+         sxr += xw * resid[i];
+         if(needXX) sxx += xw * x;
+      }
+   }
+   xr = sxr;
+   xx = sxx;
+}
+
+void packedAxpy(packedColumn col, size_t first, const size_t* index, double center, double a,
+                double* resid, size_t n) {
+   double act[4] = {a*(col.table[0]-center), a*(col.table[1]-center), a*(col.table[2]-center),
+                    a*(col.table[3]-center)};
+   size_t i=0;
+   if(index != 0) {
+      for(; i<n; i++) resid[i] -= act[(col.g[index[i]>>2] >> ((index[i] & 3) << 1)) & 3];
+      return;
+   }
+   size_t row = first;
+   for(; i<n && (row & 3) != 0; i++, row++) resid[i] -= act[(col.g[row>>2] >> ((row & 3) << 1)) & 3];
+   for(; i+4 <= n; i+=4, row+=4) {
+      unsigned char byte = col.g[row>>2];
+      resid[i]   -= act[byte & 3];
+      resid[i+1] -= act[(byte >> 2) & 3];
+      resid[i+2] -= act[(byte >> 4) & 3];
+      resid[i+3] -= act[byte >> 6];
+   }
+   for(; i<n; i++, row++) resid[i] -= act[(col.g[row>>2] >> ((row & 3) << 1)) & 3];
+}
+
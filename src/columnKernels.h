@@ -0,0 +1,70 @@
+//
+//  columnKernels.h
+//  Loops over observations for single-site updates of a covariate column, used by modelMatrix
+//  (rr) and modelFreg. The covariate for observation i is x[i] = col[index[i]] - center, or
+//  col[i] - center when index is null. With weights null all weights are taken as 1 (homogeneous
+//  residual variance, the caller multiplies with the residual precision).
+//   - columnDot: xr = sum x*w*resid, and when needXX also xx = sum x*w*x
+//   - columnAxpy: resid -= a*x
+//  For double data there are AVX2 and AVX-512 versions chosen at run-time on Linux x86-64, other
+//  systems (and float data) use the plain loops in the templates here.
+//  Packed 0/1/2 genotype columns (see dataMatrix) are read through packedColumn, and packedDot and
+//  packedAxpy decode in the loop: with an index every row is decoded from its byte, over consecutive
+//  rows (first, first+1, ...) one byte with 4 genotypes is decoded at a time through the per-column
+//  table of centered values, so the loops stream 2 bits per element instead of 8-byte doubles.
+//
+
+#ifndef columnKernels_h
+#define columnKernels_h
+
+#include <cstddef>
+
+template<typename T> void columnDotScalar(const T* col, const size_t* index, double center, const double* resid,
+                                          const double* weights, size_t n, double & xr, double & xx, bool needXX) {
+   double sxr=0.0l, sxx=0.0l, x, xw;
+   for(size_t i=0; i<n; i++) {
+      x = ((index==0) ? col[i] : col[index[i]]) - center;
+      xw = (weights==0) ? x : x*weights[i];
+      sxr += xw * resid[i];
+      if(needXX) sxx += xw * x;
+   }
+   xr = sxr;
+   xx = sxx;
+}
+
+template<typename T> void columnAxpyScalar(const T* col, const size_t* index, double center, double a,
+                                           double* resid, size_t n) {
+   for(size_t i=0; i<n; i++)
+      resid[i] -= a * (((index==0) ? col[i] : col[index[i]]) - center);
+}
+
+void columnDot(const double* col, const size_t* index, double center, const double* resid,
+               const double* weights, size_t n, double & xr, double & xx, bool needXX);
+void columnAxpy(const double* col, const size_t* index, double center, double a, double* resid, size_t n);
+
+inline void columnDot(const float* col, const size_t* index, double center, const double* resid,
+                      const double* weights, size_t n, double & xr, double & xx, bool needXX) {
+   columnDotScalar(col, index, center, resid, weights, n, xr, xx, needXX);
+}
+
+inline void columnAxpy(const float* col, const size_t* index, double center, double a, double* resid, size_t n) {
+   columnAxpyScalar(col, index, center, a, resid, n);
+}
+
+// A packed column: 2-bit codes, 4 rows per byte (row r in bits 2*(r%4) of byte r/4), and a table
+// with the values for codes 0,1,2 and 3 (NA). Indexing gives the (not centered) value of a row.
+struct packedColumn {
+   const unsigned char* g;
+   const double* table;
+   double operator[](size_t row) const { return table[(g[row>>2] >> ((row & 3) << 1)) & 3]; }
+};
+
+void packedDot(packedColumn col, size_t first, const size_t* index, double center, const double* resid,
+               const double* weights, size_t n, double & xr, double & xx, bool needXX);
+void packedAxpy(packedColumn col, size_t first, const size_t* index, double center, double a,
+                double* resid, size_t n);
+
+// 0 = plain loops, 1 = AVX2, 2 = AVX-512 (for reporting)
+int columnKernelLevel();
+
+#endif /* columnKernels_h */
@@ -0,0 +1,108 @@
+//
+//  convergenceMonitor.cpp
+//
+
+#include <cmath>
+#include "convergenceMonitor.h"
+#include "checkpointTools.h"
+
+void convergenceMonitor::init(size_t np) {
+   npar=np;
+   n=0; batchSize=1; inBatch=0; nBatches=0;
+   mean.assign(npar, 0.0l);
+   sumSq.assign(npar, 0.0l);
+   batchSum.assign(npar, 0.0l);
+   batchMeans.assign(npar*maxBatches, 0.0l);
+}
+
+void convergenceMonitor::add(const double* x) {
+   n++;
+   for(size_t j=0; j<npar; j++) {           // running mean and sum of squared deviations
+      double dev = x[j] - mean[j];
+      mean[j] += dev/double(n);
+      sumSq[j] += dev*(x[j] - mean[j]);
+      batchSum[j] += x[j];
+   }
+   inBatch++;
+   if(inBatch < batchSize) return;
+   for(size_t j=0; j<npar; j++) {
+      batchMeans[j*maxBatches+nBatches] = batchSum[j]/double(batchSize);
+      batchSum[j] = 0.0l;
+   }
+   inBatch=0;
+   nBatches++;
+   if(nBatches == maxBatches) {             // merge pairs of batches and double the batch size
+      for(size_t j=0; j<npar; j++) {
+         double* bm = &batchMeans[j*maxBatches];
+         for(size_t b=0; b<maxBatches/2; b++) bm[b] = 0.5*(bm[2*b]+bm[2*b+1]);
+      }
+      nBatches = maxBatches/2;
+      batchSize *= 2;
+   }
+}
+
+double convergenceMonitor::sigma2(size_t j) {
+   const double* bm = &batchMeans[j*maxBatches];
+   double m=0.0l, ss=0.0l;
+   for(size_t b=0; b<nBatches; b++) m += bm[b];
+   m /= double(nBatches);
+   for(size_t b=0; b<nBatches; b++) ss += (bm[b]-m)*(bm[b]-m);
+   return double(batchSize) * ss / double(nBatches-1);
+}
+
+double convergenceMonitor::ess(size_t j) {
+   if(nBatches < minBatches) return 0.0l;
+   double s2 = sigma2(j);
+   double var = sumSq[j]/double(n-1);
+   if(s2 <= 0.0l) return double(n);         // constant parameter
+   return double(n) * var / s2;
+}
+
+double convergenceMonitor::mcse(size_t j) {
+   if(nBatches < minBatches) return NAN;
+   return std::sqrt(sigma2(j)/double(n));
+}
+
+double convergenceMonitor::gewekeZ(size_t j) {
+   if(nBatches < minBatches) return NAN;
+   const double* bm = &batchMeans[j*maxBatches];
+   size_t nA = nBatches/10, nB = nBatches/2;
+   double mA=0.0l, mB=0.0l;
+   for(size_t b=0; b<nA; b++) mA += bm[b];
+   for(size_t b=nBatches-nB; b<nBatches; b++) mB += bm[b];
+   mA /= double(nA);
+   mB /= double(nB);
+   double s2 = sigma2(j);
+   if(s2 <= 0.0l) return 0.0l;
+   return (mA-mB) / std::sqrt(s2/double(nA*batchSize) + s2/double(nB*batchSize));
+}
+
+bool convergenceMonitor::reachedTargets(double targetEss, double targetMcse) {
+   if(nBatches < minBatches) return false;
+   for(size_t j=0; j<npar; j++) {
+      if(targetEss > 0 && ess(j) < targetEss) return false;
+      if(targetMcse > 0 && mcse(j) > targetMcse) return false;
+   }
+   return true;
+}
+
+void convergenceMonitor::saveState(FILE* f) {
+   size_t counters[5] = {npar, n, batchSize, inBatch, nBatches};
+   writeState(f, counters, 5);
+   writeStateVector(f, mean.data(), npar);
+   writeStateVector(f, sumSq.data(), npar);
+   writeStateVector(f, batchSum.data(), npar);
+   writeStateVector(f, batchMeans.data(), npar*maxBatches);
+}
+
+void convergenceMonitor::loadState(FILE* f) {
+   size_t counters[5];
+   readState(f, counters, 5);
+   if(counters[0] != npar)
+      throw generalRbayzError("Checkpoint file does not match the model: traced parameters are different");
+   n=counters[1]; batchSize=counters[2]; inBatch=counters[3]; nBatches=counters[4];
+   readStateVector(f, mean.data(), npar, "convergence statistics");
+   readStateVector(f, sumSq.data(), npar, "convergence statistics");
+   readStateVector(f, batchSum.data(), npar, "convergence statistics");
+   readStateVector(f, batchMeans.data(), npar*maxBatches, "convergence statistics");
+}
@@ -0,0 +1,53 @@
+//
+//  convergenceMonitor.h
+//  Streaming convergence diagnostics on the traced parameters, updated every time a sample is
+//  saved in the MCMC loop (see mcmcChain::run), so that a chain can stop as soon as a target
+//  effective sample size (ESS) and/or Monte Carlo standard error (MCSE) is reached.
+//  It uses batch means: samples are summed in batches, and when the number of batches reaches
+//  maxBatches neighbouring batches are merged and the batch size doubles. This keeps the memory
+//  fixed (maxBatches per parameter) and the batch size growing proportional to the chain length,
+//  as needed for a consistent batch-means variance estimate.
+//  Per parameter:
+//   - sigma2 = batchSize * var(batch means), the asymptotic variance of the chain mean;
+//   - MCSE = sqrt(sigma2 / n);
+//   - ESS = n * var(samples) / sigma2;
+//   - GewekeZ compares the mean of the first 10% and last 50% of batches, using sigma2 for both
+//     parts (a simplification of Geweke's spectral estimates per part).
+//
+
+#ifndef convergenceMonitor_h
+#define convergenceMonitor_h
+
+#include <vector>
+#include <stdio.h>
+#include <cstddef>
+
+class convergenceMonitor {
+
+public:
+
+   convergenceMonitor() { }
+   ~convergenceMonitor() { }
+
+   void init(size_t npar);
+   void add(const double* x);           // x has the current values of all npar traced parameters
+   double ess(size_t j);
+   double mcse(size_t j);
+   double gewekeZ(size_t j);
+   // check if all parameters reach the targets, a target <= 0 is not used
+   bool reachedTargets(double targetEss, double targetMcse);
+   void saveState(FILE* f);
+   void loadState(FILE* f);
+
+   static const size_t maxBatches = 64;
+   static const size_t minBatches = 16;  // no diagnostics and no stopping with fewer complete batches
+   size_t npar=0, n=0, batchSize=1, inBatch=0, nBatches=0;
+   std::vector<double> mean, sumSq, batchSum;
+   std::vector<double> batchMeans;       // npar x maxBatches, stored by parameter
+
+private:
+   double sigma2(size_t j);
+
+};
+
+#endif /* convergenceMonitor_h */
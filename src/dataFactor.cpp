@@ -6,7 +6,9 @@
 #include "nameTools.h"
 #include "rbayzExceptions.h"
 #include "optionsInfo.h"
+#include "hashCoder.h"
 #include <map>
+#include <algorithm>
 
 /* ------------------- dataFactor class ------------------- */
 
@@ -98,23 +100,9 @@ void dataFactor::run_constructor(std::vector<Rcpp::RObject> variableObjects,
       labels = std::move(factorList[0]->labels);
       name = std::move(factorList[0]->name);
    }
-   else { // multiple factors to collapse: recode interaction levels by pasting labels together.
-      std::vector<std::string> pasted_data_labels;
-      paste_data_labels(pasted_data_labels, factorList);
-      std::vector<std::string> unique_labels = pasted_data_labels;
-      std::sort(unique_labels.begin(), unique_labels.end());
-      std::vector< std::string>::iterator last = std::unique (unique_labels.begin(), unique_labels.end());
-      unique_labels.erase(last, unique_labels.end());
+   else { // multiple factors to collapse: recode interaction levels from the level codes of the factors
       initWith(Ndata, 0);
-      std::vector<std::string>::iterator p;
-      // code the data by searching the pasted_data_labels in the unique_labels
-      for(size_t i=0; i<Ndata; i++) {
-         p = std::lower_bound(unique_labels.begin(), unique_labels.end(), pasted_data_labels[i]);
-         data[i] = p - unique_labels.begin();
-      }
-      // fill labels vector
-      labels.reserve(unique_labels.size());
-      for(p=unique_labels.begin(); p != unique_labels.end(); p++) labels.push_back(*p);
+      code_interaction(factorList, data, labels);
       // The name of the interaction coming from the model-term is lost here, reconstruct it ...
       name = factorList[0]->name;
       for(size_t i=1; i< factorList.size(); i++) name += ":" + factorList[i]->name;
@@ -130,6 +118,18 @@ void dataFactor::run_constructor(std::vector<Rcpp::RObject> variableObjects,
 dataFactor::~dataFactor() {
 }
 
+// Counting sort of the observations on their level code: count per level, cumulative counts give
+// the start positions, and a pass over the observations in order fills levelObs.
+void dataFactor::buildLevelIndex() {
+   size_t nlevels = labels.size();
+   levelStart.assign(nlevels+1, 0);
+   levelObs.resize(nelem);
+   for(size_t obs=0; obs < nelem; obs++) levelStart[data[obs]+1]++;
+   for(size_t k=0; k < nlevels; k++) levelStart[k+1] += levelStart[k];
+   std::vector<size_t> next(levelStart.begin(), levelStart.end()-1);
+   for(size_t obs=0; obs < nelem; obs++) levelObs[next[data[obs]]++] = obs;
+}
+
 /* ------------------- dataFactorNC class ------------------- */
 
 // dataFactorNC also derives from simpleFactor, and has similar working, but keeps the factorList of simpleFactor objects.
@@ -187,33 +187,20 @@ dataFactorNC::dataFactorNC(std::vector<Rcpp::RObject> variableObjects, std::vect
    }
    nelem = Ndata;
 
-   // code the interaction levels - code repeated from dataFactor, but here don't need to handle the single factor case.
-   // Additional: also fill firstOccurence vector while coding, it needs a helper vector to track if a level is already
+   // code the interaction levels - as in dataFactor, but here don't need to handle the single factor case.
+   // Additional: also fill firstOccurence vector, it needs a helper vector to track if a level is already
    // seen or not to mark if a data row has the first occurence of a level, or else it is a duplicate.
 
-   std::vector<std::string> pasted_data_labels;
-   paste_data_labels(pasted_data_labels, factorList);
-   std::vector<std::string> unique_labels = pasted_data_labels;
-   std::sort(unique_labels.begin(), unique_labels.end());
-   std::vector< std::string>::iterator last = std::unique (unique_labels.begin(), unique_labels.end());
-   unique_labels.erase(last, unique_labels.end());
    initWith(Ndata, 0);
-   std::vector<std::string>::iterator p;
+   code_interaction(factorList, data, labels);
    firstOccurence.initWith(Ndata, 0); // initialize all to 0 ('false')
-   simpleIntVector seen_levels(unique_labels.size()); // to track seen levels, it is initialized to 0!
-   // code the data by searching the pasted_data_labels in the unique_labels
+   std::vector<bool> seen_levels(labels.size(), false); // to track seen levels
    for(size_t i=0; i<Ndata; i++) {
-      p = std::lower_bound(unique_labels.begin(), unique_labels.end(), pasted_data_labels[i]);
-      data[i] = p - unique_labels.begin();
-      // track first occurrence
-      if (seen_levels[data[i]] == 0) {
-         firstOccurence[data[i]] = 1; // 'true' for first occurence
+      if (!seen_levels[data[i]]) {
+         firstOccurence[i] = 1; // 'true' for first occurence
+         seen_levels[data[i]] = true;
       }
-      seen_levels[data[i]] = 1;
    }
-   // fill labels vector
-   labels.reserve(unique_labels.size());
-   for(p=unique_labels.begin(); p != unique_labels.end(); p++) labels.push_back(*p);
    // The name of the interaction coming from the model-term is lost here, reconstruct it ...
    name = factorList[0]->name;
    for(size_t i=1; i< factorList.size(); i++) name += ":" + factorList[i]->name;
@@ -226,17 +213,48 @@ dataFactorNC::~dataFactorNC() {
       delete factorList[i];
 }
 
-// paste_data_labels: given a vector of simpleFactor pointers, create pasted labels for all data rows;
-// The function is designed to avoid making a copy of the pasted labels vector, if it would be returned,
-// now the calling code should make an empty vector and pass it by reference to be filled.
-void paste_data_labels(std::vector<std::string> & pasted_labels, const std::vector<simpleFactor *> & factorList) {
+// code_interaction: code the interaction of the factors in factorList from their integer level codes.
+// The level codes make a mixed-radix key per row (k0 + n0*k1 + n0*n1*k2 ..., where n are the numbers
+// of levels); when the key would not fit in 62 bits the keys so far are first compacted to their
+// distinct codes. The distinct keys are coded with the hash coder (see hashCoder.h), and only for
+// these levels labels are made by pasting the factor labels (from the first row with the level).
+// The levels are ordered as the sorted pasted labels, which is the same coding as when all rows were
+// pasted and sorted before (also merging combinations that happen to give the same label).
+void code_interaction(const std::vector<simpleFactor *> & factorList, int* codes, std::vector<std::string> & labels) {
    size_t Ndata = factorList[0]->nelem;
-   pasted_labels = factorList[0]->back2vecstring();
-   for(size_t i=1; i<factorList.size(); i++) {
-      std::vector<std::string> next_strings(factorList[i]->back2vecstring());
-      for(size_t j=0; j<Ndata; j++)
-         pasted_labels[j] += "." + next_strings[j];
+   const uint64_t maxRadix = uint64_t(1) << 62;
+   std::vector<uint64_t> key(Ndata, 0);
+   std::vector<uint64_t> distinct;
+   uint64_t radix = 1;
+   for(size_t f=0; f<factorList.size(); f++) {
+      uint64_t nlev = factorList[f]->labels.size();
+      if(nlev == 0) nlev = 1;
+      if(radix > maxRadix / nlev) {
+         hashCodeColumn<uint64_t, hashKey>(key.data(), Ndata, UINT64_MAX, codes, distinct);
+         for(size_t i=0; i<Ndata; i++) key[i] = uint64_t(codes[i]);
+         radix = distinct.size();
+      }
+      const int* levels = factorList[f]->data;
+      for(size_t i=0; i<Ndata; i++) key[i] += radix * uint64_t(levels[i]);
+      radix *= nlev;
+   }
+   hashCodeColumn<uint64_t, hashKey>(key.data(), Ndata, UINT64_MAX, codes, distinct);
+   std::vector<size_t> firstRow(distinct.size(), Ndata);
+   for(size_t i=0; i<Ndata; i++) if(firstRow[codes[i]] == Ndata) firstRow[codes[i]] = i;
+   std::vector<std::string> distinct_labels(distinct.size());
+   for(size_t c=0; c<distinct.size(); c++) {
+      size_t row = firstRow[c];
+      distinct_labels[c] = factorList[0]->labels[factorList[0]->data[row]];
+      for(size_t f=1; f<factorList.size(); f++)
+         distinct_labels[c] += "." + factorList[f]->labels[factorList[f]->data[row]];
    }
+   labels = distinct_labels;
+   std::sort(labels.begin(), labels.end());
+   labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+   std::vector<int> newCode(distinct.size());
+   for(size_t c=0; c<distinct.size(); c++)
+      newCode[c] = int(std::lower_bound(labels.begin(), labels.end(), distinct_labels[c]) - labels.begin());
+   recodeColumn(codes, Ndata, newCode, 0);
 }
 
 /*
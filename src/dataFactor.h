@@ -38,6 +38,10 @@ public:
          std::vector<std::string> variableNames, std::vector<varianceSpec> varlist);
    ~dataFactor();
    int Nvar;  // The number of variables (interactions) in this factor
+   // CSR-style index from levels to observations, made by buildLevelIndex(): the observations with
+   // level k are levelObs[levelStart[k]] .. levelObs[levelStart[k+1]-1], in increasing order.
+   void buildLevelIndex();
+   std::vector<size_t> levelStart, levelObs;
 };
 
 class dataFactorNC : public simpleFactor {
@@ -50,6 +54,6 @@ public:
    simpleIntVector firstOccurence; // similar as R duplicate() function, but opposite interpretation.
 };
 
-void paste_data_labels(std::vector<std::string> & pasted_labels, const std::vector<simpleFactor *> & factorList);
+void code_interaction(const std::vector<simpleFactor *> & factorList, int* codes, std::vector<std::string> & labels);
 
 #endif /* dataFactor_h */
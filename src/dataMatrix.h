@@ -2,6 +2,18 @@
 //  Class for storage of matrix of covariates (e.g. input in rr() model).
 //  Derives from labeledMatrix so it has rownames (and optionally colnames), and
 //  makes column centering of the input data.
+//  The matrix data is borrowed from R without copying, and the centering is not applied on the data
+//  but stored as column means in colCenter, to be subtracted when using the data (column(col)[row] -
+//  colCenter[col]). Only when there are missing values a copy is made to fill the missings with the
+//  column mean (so that they become zero after centering).
+//  Matrices with only 0/1/2/NA values (genotypes, numeric or integer) are stored packed with 2 bits
+//  per element, with per column a lookup table to decode 0/1/2 and NA (decoded as the column mean).
+//  The data is then not in data[][], but packedCol(col) gives the packed column with its table, and the
+//  loops in modelMatrix decode it on the fly (see packedDot and packedAxpy in columnKernels.h).
+//  With storeAsFloat() the (not packed) data is stored centered in float, colCenter is then zero.
+//  A sparse matrix (dgCMatrix from the Matrix package) is stored column-compressed as in R (sparseStart,
+//  sparseRow, sparseVal), without centering; modelMatrix handles the centering algebraically in the
+//  column updates. column(col) also works for a sparse matrix and decodes a dense column.
 //
 //  Created by Luc Janss on 05/03/2020.
 //
@@ -10,39 +22,56 @@
 #define dataMatrix_h
 
 #include <math.h>  // needed?
+#include <vector>
+#include <cstdint>
 #include "labeledMatrix.h"
+#include "simpleVector.h"
+#include "columnKernels.h"
 
 class dataMatrix : public labeledMatrix {
 
 public:
-   dataMatrix(Rcpp::RObject col, std::string & name) : labeledMatrix(col, name) {
-      // column-center the matrix data and fill missings with column mean.
-      // (and after centering the column means are zero for all columns).
-      double * datacol;
-      size_t i,j, nobs;
-      double sum;
-      for(i=0; i<ncol; i++) {
-         datacol = data[i];
-         sum=0.0l; nobs=0;
-         for(j=0; j<nrow; j++) {
-            if (! std::isnan(datacol[j]) ) { // cannot catch it as NA_REAL after is has been copied
-               sum+=datacol[j];         // in the simpleMatrix structure ... maybe can be improved?
-               nobs++;
-            }
-         }
-         sum /= double(nobs);
-         for(j=0; j<nrow; j++) {
-            if ( std::isnan(datacol[j]))
-               datacol[j] = 0.0l;
-            else 
-               datacol[j] -= sum;
-         }
-      }
-   }
+   dataMatrix(Rcpp::RObject col, std::string & name);
 
    ~dataMatrix() {
    }
 
+   // pointer to the (not centered) data of column col, not for a packed matrix; in a sparse matrix
+   // the pointer is to a scratch vector that is valid until another column is retrieved.
+   double* column(size_t col) {
+      if(!sparse) return data[col];
+      if(col != decodedCol) decodeColumn(col);
+      return decoded.data();
+   }
+
+   packedColumn packedCol(size_t col) {
+      packedColumn p;
+      p.g = &genotypes[col*bytesPerCol];
+      p.table = &decodeTable[4*col];
+      return p;
+   }
+
+   void storeAsFloat() {
+      convertToFloat(colCenter.data);
+      for(size_t col=0; col<ncol; col++) colCenter[col]=0.0l;
+   }
+
+   simpleDblVector colCenter;
+   bool packed=false;
+   bool sparse=false;
+   std::vector<int> sparseStart, sparseRow;   // column starts (ncol+1) and row numbers of the non-zeros
+   std::vector<double> sparseVal;
+
+private:
+   std::vector<unsigned char> genotypes;   // packed genotypes, 4 per byte, column by column
+   size_t bytesPerCol=0;
+   std::vector<double> decodeTable;        // per column 4 values for codes 0,1,2 and 3 (NA)
+   std::vector<double> decoded;            // scratch column for column() of a sparse matrix
+   size_t decodedCol=SIZE_MAX;
+   bool packGenotypes(Rcpp::RObject col);
+   bool loadSparse(Rcpp::RObject col, const std::string & name);
+   void decodeColumn(size_t col);
+
 };
 
 #endif /* dataMatrix_h */
@@ -0,0 +1,181 @@
+//
+//  hashCoder.h
+//  Coding of data values (integers, strings, R CHARSXP pointers for character data, or 64-bit keys) to
+//  integer codes with an open-addressing hash table, used by simpleFactor to code factor levels and by
+//  dataFactor to code interactions.
+//   - hashCoder: gives every distinct key a code 0,1,2,.. in order of first appearance; the keys are
+//     in keys[code]. The table has linear probing, a power-of-2 size and is kept at most half full.
+//   - hashCodeColumn: codes a data column in first-appearance order (NA values get code -1). Large
+//     columns are coded in parallel in two passes: every thread codes a slice of the rows with its own
+//     dictionary, the dictionaries are merged in order of the slices, and then the rows are recoded
+//     with the merged codes. Merging in order of the slices gives the same codes as one pass over all
+//     rows, so the result does not depend on the number of threads.
+//   - recodeColumn: replaces codes by newCode[code], and code -1 by naCode (also in parallel).
+//  The threads only read the data and key arrays, and do not use R.
+//
+
+#ifndef hashCoder_h
+#define hashCoder_h
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+inline uint64_t hashMix(uint64_t x) {
+   x ^= x >> 33;
+   x *= 0xff51afd7ed558ccdULL;
+   x ^= x >> 33;
+   x *= 0xc4ceb9fe1a85ec53ULL;
+   x ^= x >> 33;
+   return x;
+}
+
+struct hashInt {
+   uint64_t operator()(int x) const { return hashMix(uint64_t(uint32_t(x))); }
+};
+
+struct hashKey {
+   uint64_t operator()(uint64_t x) const { return hashMix(x); }
+};
+
+struct hashPointer {
+   uint64_t operator()(const void* p) const { return hashMix(uint64_t(uintptr_t(p))); }
+};
+
+struct hashString {          // FNV-1a
+   uint64_t operator()(const std::string & s) const {
+      uint64_t h = 14695981039346656037ULL;
+      for(size_t i=0; i<s.size(); i++) {
+         h ^= uint64_t((unsigned char) s[i]);
+         h *= 1099511628211ULL;
+      }
+      return hashMix(h);
+   }
+};
+
+template<typename K, typename H> class hashCoder {
+
+public:
+
+   hashCoder(size_t expected=16) {
+      size_t size=16;
+      while(size < 2*expected) size *= 2;
+      slots.assign(size, -1);
+      mask = size-1;
+   }
+
+   // code of key, a new code is made when key is not in the table yet
+   int code(const K & key) {
+      size_t i = size_t(hasher(key)) & mask;
+      while(slots[i] >= 0) {
+         if(keys[slots[i]] == key) return slots[i];
+         i = (i+1) & mask;
+      }
+      int c = int(keys.size());
+      slots[i] = c;
+      keys.push_back(key);
+      if(2*keys.size() > slots.size()) grow();
+      return c;
+   }
+
+   // code of key, or -1 when key is not in the table
+   int find(const K & key) const {
+      size_t i = size_t(hasher(key)) & mask;
+      while(slots[i] >= 0) {
+         if(keys[slots[i]] == key) return slots[i];
+         i = (i+1) & mask;
+      }
+      return -1;
+   }
+
+   std::vector<K> keys;
+
+private:
+
+   std::vector<int> slots;
+   size_t mask;
+   H hasher;
+
+   void grow() {
+      slots.assign(2*slots.size(), -1);
+      mask = slots.size()-1;
+      for(size_t c=0; c<keys.size(); c++) {
+         size_t i = size_t(hasher(keys[c])) & mask;
+         while(slots[i] >= 0) i = (i+1) & mask;
+         slots[i] = int(c);
+      }
+   }
+
+};
+
+// number of threads for coding a column of n rows, parallel from 1M rows on
+inline size_t hashCodeThreads(size_t n) {
+   if(n < (size_t(1) << 20)) return 1;
+   size_t nthreads = std::thread::hardware_concurrency();
+   if(nthreads > 8) nthreads = 8;
+   if(nthreads < 1) nthreads = 1;
+   return nthreads;
+}
+
+template<typename K, typename H>
+void hashCodeColumn(const K* x, size_t n, const K & na, int* codes, std::vector<K> & keys) {
+   size_t nthreads = hashCodeThreads(n);
+   if(nthreads == 1) {
+      hashCoder<K,H> coder;
+      for(size_t i=0; i<n; i++) codes[i] = (x[i] == na) ? -1 : coder.code(x[i]);
+      keys.swap(coder.keys);
+      return;
+   }
+   std::vector< hashCoder<K,H> > local(nthreads);
+   std::vector<std::thread> threads;
+   for(size_t t=0; t<nthreads; t++) {
+      threads.push_back(std::thread([&, t]() {
+         size_t lo = n*t/nthreads, hi = n*(t+1)/nthreads;
+         for(size_t i=lo; i<hi; i++) codes[i] = (x[i] == na) ? -1 : local[t].code(x[i]);
+      }));
+   }
+   for(size_t t=0; t<nthreads; t++) threads[t].join();
+   hashCoder<K,H> merged;
+   std::vector< std::vector<int> > remap(nthreads);
+   for(size_t t=0; t<nthreads; t++) {
+      remap[t].resize(local[t].keys.size());
+      for(size_t c=0; c<local[t].keys.size(); c++) remap[t][c] = merged.code(local[t].keys[c]);
+   }
+   threads.clear();
+   for(size_t t=0; t<nthreads; t++) {
+      threads.push_back(std::thread([&, t]() {
+         size_t lo = n*t/nthreads, hi = n*(t+1)/nthreads;
+         for(size_t i=lo; i<hi; i++) if(codes[i] >= 0) codes[i] = remap[t][codes[i]];
+      }));
+   }
+   for(size_t t=0; t<nthreads; t++) threads[t].join();
+   keys.swap(merged.keys);
+}
+
+// returns true when there were NA (code -1) values
+inline bool recodeColumn(int* codes, size_t n, const std::vector<int> & newCode, int naCode) {
+   size_t nthreads = hashCodeThreads(n);
+   std::vector<char> foundNA(nthreads, 0);
+   auto recodeSlice = [&](size_t t) {
+      size_t lo = n*t/nthreads, hi = n*(t+1)/nthreads;
+      for(size_t i=lo; i<hi; i++) {
+         if(codes[i] < 0) {
+            codes[i] = naCode;
+            foundNA[t] = 1;
+         }
+         else codes[i] = newCode[codes[i]];
+      }
+   };
+   if(nthreads == 1) recodeSlice(0);
+   else {
+      std::vector<std::thread> threads;
+      for(size_t t=0; t<nthreads; t++) threads.push_back(std::thread(recodeSlice, t));
+      for(size_t t=0; t<nthreads; t++) threads[t].join();
+   }
+   bool anyNA=false;
+   for(size_t t=0; t<nthreads; t++) if(foundNA[t]) anyNA=true;
+   return anyNA;
+}
+
+#endif /* hashCoder_h */
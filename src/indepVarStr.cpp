@@ -21,7 +21,7 @@ void indepVarStr::sampleScale(double lhs, double rhs) {
     double curr_scale = sqrt(par->val[0]);
     double sample_mean = curr_scale*rhs/lhs;
     double sample_sd = curr_scale/sqrt(lhs);
-    double scale = R::rnorm( sample_mean, sample_sd);
+    double scale = Rbayz::rng->rnorm( sample_mean, sample_sd);
     par->val[0] = scale*scale;
 }
 
@@ -31,6 +31,7 @@ idenVarStr::idenVarStr(parsedModelTerm & modeldescr, parVector* coefpar) : indep
    par = new parVector(modeldescr, 1.0l, "var");
    par->traced=1;
    par->varianceStruct="IDEN";
+   scaledWeights=true;
 }
 
 idenVarStr::~idenVarStr() {
@@ -40,15 +41,22 @@ idenVarStr::~idenVarStr() {
 void idenVarStr::restart() {
    double invvar = 1.0l/par->val[0];
    for(size_t k=0; k < weights.nelem; k++) weights[k] = invvar;
+   weightScale = invvar;
+   weightsVersion++;
 }
 
+// With method VB the expected sum of squares adds the posterior variances in vbVar.
 void idenVarStr::sample() {
   double ssq=0.0;
   for(size_t k=0; k < coefpar->nelem; k++)
      ssq += coefpar->val[k]*coefpar->val[k];
+  for(size_t k=0; k < coefpar->vbVar.size(); k++)
+     ssq += coefpar->vbVar[k];
   par->val[0] = gprior.samplevar(ssq,coefpar->nelem);
   double invvar = 1.0l/par->val[0];
   for(size_t k=0; k < weights.nelem; k++) weights[k] = invvar;
+  weightScale = invvar;
+  weightsVersion++;
 }
 
 // ---- diagVarStr class ----
@@ -74,6 +82,8 @@ diagVarStr::diagVarStr(parsedModelTerm & modeldescr, parVector* coefpar, simpleD
     // Probably, it can be assumed this is always OK when using this constructor where the
     // third arg is a simpleDblVector (then it must remain present somewhere else until cleanup).
     diag.initWith(Ddiag);
+    for(size_t k=0; k < weights.nelem; k++) weights[k] = 1.0l / diag.data[k];
+    scaledWeights=true;
 }
 
 diagVarStr::~diagVarStr() {
@@ -101,6 +111,8 @@ diagVarStr::diagVarStr(parsedModelTerm & modeldescr, parVector* coefpar) : indep
         par->traced=1;
         par->varianceStruct="DIAG";
         diag.initWith(tempDiag);
+        for(size_t k=0; k < weights.nelem; k++) weights[k] = 1.0l / diag.data[k];
+        scaledWeights=true;
     }
     catch(std::exception &err) {
         Rbayz::Messages.push_back(std::string(err.what()));
@@ -113,15 +125,21 @@ diagVarStr::diagVarStr(parsedModelTerm & modeldescr, parVector* coefpar) : indep
 void diagVarStr::restart() {
    double invvar = 1.0l/par->val[0];
    for(size_t k=0; k < weights.nelem; k++) weights[k] = invvar / diag.data[k];
+   weightScale = invvar;
+   weightsVersion++;
 }
 
 void diagVarStr::sample() {
   double ssq=0.0;
   for(size_t k=0; k < coefpar->nelem; k++)
      ssq += coefpar->val[k]*coefpar->val[k]/diag.data[k];
+  for(size_t k=0; k < coefpar->vbVar.size(); k++)
+     ssq += coefpar->vbVar[k]/diag.data[k];
   par->val[0] = gprior.samplevar(ssq,coefpar->nelem);
   double invvar = 1.0l/par->val[0];
   for(size_t k=0; k < weights.nelem; k++) weights[k] = invvar / diag.data[k];
+  weightScale = invvar;
+  weightsVersion++;
 }
 
 /* ---- grid-LASSO ----
@@ -177,6 +195,7 @@ lassVarStr::~lassVarStr() {
 void lassVarStr::restart() {
    double invvar = 1.0l/par->val[0];
    for(size_t k=0; k < weights.nelem; k++) weights[k] = invvar / diag.data[k];
+   weightsVersion++;
 }
 
 // this is still copy from diagVarStr, but it will probably look most like idenVarStr ...
@@ -187,13 +206,17 @@ void lassVarStr::sample() {
   par->val[0] = gprior.samplevar(ssq,coefpar->nelem);
   double invvar = 1.0l/par->val[0];
   for(size_t k=0; k < weights.nelem; k++) weights[k] = invvar / diag.data[k];
+  weightsVersion++;
 }
 
-// ---- mixtVarStr ---- (not yet finished)
+// ---- mixtVarStr ----
 
-// mixtVarStr is now standard 2-class mixture with pi0, pi1, v0, v1
+// mixtVarStr is a mixture with Ncat classes, V=MIXT[vars(v1,v2,..),counts(c1,c2,..)]: vars are the
+// relative variances of the classes (0 for a null class), counts are the Dirichlet prior counts for
+// the class proportions pi. With vars(0,1) this is BayesC-pi.
 
-mixtVarStr::mixtVarStr(parsedModelTerm & modeldescr, parVector* coefpar) : indepVarStr(modeldescr, coefpar) {
+mixtVarStr::mixtVarStr(parsedModelTerm & modeldescr, parVector* coefpar)
+          : indepVarStr(modeldescr, coefpar), indicator() {
 
     // This only accepts one variance-structure MIXT, not combinations, and there should be vars and counts options.
     std::vector<varianceSpec> varlist = modeldescr.allOptions.Vlist();
@@ -206,33 +229,105 @@ mixtVarStr::mixtVarStr(parsedModelTerm & modeldescr, parVector* coefpar) : indep
         throw generalRbayzError("In "+modeldescr.shortModelTerm+" MIXT[] has different number of elements in vars() and counts()");
     }
     Ncat = vars_option.valnumb.size();
+    if(Ncat < 2) {
+        throw generalRbayzError("In "+modeldescr.shortModelTerm+" MIXT[] needs at least two classes");
+    }
     Vars.resize(Ncat,0.0l);
-    Counts.resize(Ncat,0);
-    int total_counts=0;
+    Counts.resize(Ncat,0.0l);
+    logp.resize(Ncat,0.0l);
+    double total_counts=0.0l;
+    size_t largest=0;
     for(size_t i=0; i<Ncat; i++) {
         Vars[i]=vars_option.valnumb[i];
-        Counts[i]=(int)vars_option.valnumb[i];
+        Counts[i]=counts_option.valnumb[i];
+        if(Vars[i] < 0.0l || Counts[i] <= 0.0l)
+            throw generalRbayzError("In "+modeldescr.shortModelTerm+" MIXT[] needs vars() >= 0 and counts() > 0");
+        if(Vars[i] > Vars[largest]) largest=i;
         total_counts += Counts[i];
     }
+    if(Vars[largest]==0.0l)
+        throw generalRbayzError("In "+modeldescr.shortModelTerm+" MIXT[] needs at least one class with non-zero variance");
     std::vector<std::string> temp_labels = generateLabels("pi",Ncat);
     temp_labels.insert(temp_labels.begin(),"var");
-    par = new parVector(modeldescr, 1.0l, temp_labels);
+    Rcpp::CharacterVector labels = Rcpp::wrap(temp_labels);
+    par = new parVector(modeldescr, 1.0l, labels, "var");
     for(size_t i=1; i<=Ncat; i++)          // The pi's are initialized from the prior counts
-        par->val[i] = Counts[i]/total_counts;
+        par->val[i] = Counts[i-1]/total_counts;
     par->traced=1;
     par->varianceStruct="MIXT";
+    // all coefficients start in the class with the largest variance
+    indicator.initWith(coefpar->nelem, int(largest));
+    restart();
 }
 
 mixtVarStr::~mixtVarStr() {
     delete par;
 }
 
+void mixtVarStr::setWeight(size_t k) {
+    double v = Vars[indicator[k]] * par->val[0];
+    weights[k] = (v > 0.0l) ? 1.0l/v : std::numeric_limits<double>::infinity();
+    weightsVersion++;
+}
+
 void mixtVarStr::restart() {
-    // ??
+    for(size_t k=0; k < weights.nelem; k++) setWeight(k);
+}
+
+// Sample the class of coefficient k given lhs = x'Wx and rhs = x'W(resid + beta x), with the coefficient
+// integrated out: relative to beta=0 the log-probability of a class with variance v is
+// log(pi) - 0.5 log(1 + v lhs) + 0.5 rhs^2 / (lhs + 1/v). The weight for the class is set, so that the
+// coefficient can then be sampled with the (inf) weight as in other rr() models.
+size_t mixtVarStr::sampleClass(size_t k, double lhs, double rhs) {
+    double v, maxlogp=-std::numeric_limits<double>::infinity();
+    for(size_t c=0; c<Ncat; c++) {
+        logp[c] = log(par->val[c+1]);
+        if(Vars[c] > 0.0l) {
+            v = Vars[c] * par->val[0];
+            logp[c] += -0.5*log(1.0l + v*lhs) + 0.5*rhs*rhs/(lhs + 1.0l/v);
+        }
+        if(logp[c] > maxlogp) maxlogp = logp[c];
+    }
+    double sum=0.0l;
+    for(size_t c=0; c<Ncat; c++) {
+        logp[c] = exp(logp[c]-maxlogp);
+        sum += logp[c];
+    }
+    double u = Rbayz::rng->runif(0,1) * sum;
+    size_t c=0;
+    while(c < Ncat-1 && u > logp[c]) {
+        u -= logp[c];
+        c++;
+    }
+    indicator[k] = int(c);
+    setWeight(k);
+    return c;
 }
 
+// The variance is sampled from the coefficients in the non-null classes (scaled by their relative
+// variances), and pi from the Dirichlet with the prior counts plus the class counts.
 void mixtVarStr::sample() {
-    // add sample implementation
+    std::vector<double> classCount(Ncat, 0.0l);
+    double ssq=0.0l;
+    size_t nNonNull=0;
+    int c;
+    for(size_t k=0; k < coefpar->nelem; k++) {
+        c = indicator[k];
+        classCount[c] += 1.0l;
+        if(Vars[c] > 0.0l) {
+            ssq += coefpar->val[k]*coefpar->val[k]/Vars[c];
+            nNonNull++;
+        }
+    }
+    // with very few non-null coefficients the variance is kept, the default (flat) prior needs n > 2
+    if(nNonNull > 2 || !gprior.useDefault) par->val[0] = gprior.samplevar(ssq, nNonNull);
+    double sum=0.0l;
+    for(size_t i=0; i<Ncat; i++) {
+        par->val[i+1] = Rbayz::rng->rgamma(Counts[i] + classCount[i]);
+        sum += par->val[i+1];
+    }
+    for(size_t i=0; i<Ncat; i++) par->val[i+1] /= sum;
+    restart();
 }
 
 // ---- logLinVarStr ---- (to do)
@@ -27,7 +27,21 @@ public:
    indepVarStr(parsedModelTerm & modeldescr, parVector* cpar);
    virtual ~indepVarStr() { }
    void sampleScale(double lhs, double rhs);
+   void saveState(FILE* f) {
+      writeStateVector(f, weights.data, weights.nelem);
+   }
+   void loadState(FILE* f) {
+      readStateVector(f, weights.data, weights.nelem, "weights of " + par->Name);
+      weightsVersion++;
+      if(scaledWeights) weightScale = 1.0l/par->val[0];
+   }
    simpleDblVector weights;
+   // For models that use the weights as residual precisions: weightsVersion is increased every time
+   // the weights change, and with scaledWeights the weights are weightScale (1/var) times fixed
+   // relative weights (all 1 for IDEN, 1/diag for DIAG), so sums of weights can be rescaled.
+   unsigned long weightsVersion=0;
+   bool scaledWeights=false;
+   double weightScale=1.0l;
 };
 
 class idenVarStr : public indepVarStr {
@@ -65,18 +79,31 @@ public:
     simpleDblVector diag;
 };
 
+// Mixture (BayesC-pi type) with Ncat classes, class c has variance Vars[c]*var, where a class with
+// Vars[c]=0 is a null class (coefficient zero, weight inf). par has var and the class proportions
+// pi1..piNcat; indicator has the class of every coefficient.
 class mixtVarStr : public indepVarStr {
 public:
     mixtVarStr(parsedModelTerm & modeldescr, parVector* coefpar);
     ~mixtVarStr();
     void restart();
     void sample();
-    int Ncat;
+    size_t sampleClass(size_t k, double lhs, double rhs);
+    void setWeight(size_t k);
+    void saveState(FILE* f) {
+      indepVarStr::saveState(f);
+      writeStateVector(f, indicator.data, indicator.nelem);
+    }
+    void loadState(FILE* f) {
+      indepVarStr::loadState(f);
+      readStateVector(f, indicator.data, indicator.nelem, "mixture classes of " + coefpar->Name);
+    }
+    size_t Ncat;
     std::vector<double> Vars;
-    std::vector<int> Counts;
-    simpleDblVector diag;
-//    getSetOptions(modeldescr.allOptions["V"]); // not yet defined?
-//    modelBVS *mixmod;
+    std::vector<double> Counts;
+    simpleIntVector indicator;
+private:
+    std::vector<double> logp;
 };
 
 class loglinVarStr : public indepVarStr {
@@ -6,36 +6,40 @@
 
 #include "indexTools.h"
 #include "rbayzExceptions.h"
+#include "hashCoder.h"
+#include "nameTools.h"
 
-// Comparison function to search for a string in a vector of pair<string, number>
-inline bool compString2Pair(const std::pair<std::string, size_t> & p, const std::string & s)
-{
-    return p.first < s;
-}
-
+// builObsIndex: index from every observation (row in the data) to its row in the matrix M, matched
+// on the factor labels and matrix rownames. The matrix rownames are put in a hash table (the first row
+// is used if a name is repeated), every factor level is looked up once, and the index for the
+// observations follows from the level codes. Levels in the data that are not in the rownames are
+// reported in the Messages and give an error.
 void builObsIndex(std::vector<size_t> & obsIndex, dataFactor *F, labeledMatrix *M) {
-   int errors=0;
-//   Rcpp::Rcout << "Going to resize obsIndex to " << F->data.size() << "\n";
-   obsIndex.resize(F->nelem,0);
-   // Build a sorted list of the matrix rownames paired with matrix entry-rows
-   std::vector< std::pair<std::string, size_t> > matLabelsSorted;
-   for(size_t i=0; i< M->rownames.size(); i++)
-      matLabelsSorted.push_back(std::make_pair(M->rownames[i], i));
-   std::sort(matLabelsSorted.begin(),matLabelsSorted.end()); // shoud be enough
-   // Make the index that links observations to matrix rows
-   std::string s;
-   std::vector< std::pair<std::string, size_t> >::iterator it;
-   for(size_t i=0; i<F->nelem; i++) {
-      s = F->labels[F->data[i]];
-      if ( (it = std::lower_bound(matLabelsSorted.begin(), matLabelsSorted.end(), s, compString2Pair)) != matLabelsSorted.end()) {
-         obsIndex[i]=it->second;
-      }
-      else {
-         // error [ToDo] can be nicer in messages list
-         Rcpp::Rcout << "ID " << s << " is not available in similarity/kernel matrix\n";
-         errors++;
-      }
+   hashCoder<std::string, hashString> rowCoder(M->rownames.size());
+   std::vector<size_t> rowIndex;
+   for(size_t i=0; i< M->rownames.size(); i++) {
+      if (rowCoder.code(M->rownames[i]) == int(rowIndex.size()))
+         rowIndex.push_back(i);
    }
-   if(errors)
-      throw (generalRbayzError("Some IDs not found in similarity/kernel matrix"));
+   // only levels that are present in the data need to match
+   std::vector<bool> levelUsed(F->labels.size(), false);
+   for(size_t i=0; i<F->nelem; i++) levelUsed[F->data[i]] = true;
+   std::vector<size_t> levelRow(F->labels.size(), 0);
+   std::vector<std::string> unmatched_levels;
+   for(size_t lev=0; lev < F->labels.size(); lev++) {
+      if (!levelUsed[lev]) continue;
+      int code = rowCoder.find(F->labels[lev]);
+      if (code < 0)
+         unmatched_levels.push_back(F->labels[lev]);
+      else
+         levelRow[lev] = rowIndex[code];
+   }
+   if( unmatched_levels.size() > 0 )
+      stopUnmatchedLevels("There are levels in factor " + F->name +
+                          " that are not available in the rownames of the similarity/kernel matrix:",
+                          unmatched_levels, "Some IDs not found in similarity/kernel matrix - see messages output");
+   // Make the index that links observations to matrix rows
+   obsIndex.resize(F->nelem);
+   for(size_t i=0; i<F->nelem; i++)
+      obsIndex[i] = levelRow[F->data[i]];
 }
@@ -0,0 +1,224 @@
+//
+//  jointFixedSampler.cpp
+//
+
+#include <cmath>
+#include <string>
+#include "jointFixedSampler.h"
+#include "modelMean.h"
+#include "modelFixf.h"
+#include "modelFreg.h"
+#include "blockKernels.h"
+#include "rbayzExceptions.h"
+
+jointFixedSampler::jointFixedSampler(std::vector<modelBase*> & models, modelResp* rmod) : respModel(rmod) {
+   resid = rmod->resid->val;
+   residPrec = rmod->varModel->weights.data;
+   nobs = rmod->resid->nelem;
+   // the fx() term with most levels goes first and makes the sparse block
+   size_t first = models.size();
+   for(size_t i=0; i<models.size(); i++) {
+      modelFixf* fx = dynamic_cast<modelFixf*>(models[i]);
+      if(fx != 0 && (first == models.size() ||
+                     fx->F->labels.size() > dynamic_cast<modelFixf*>(models[first])->F->labels.size()))
+         first = i;
+   }
+   std::vector<modelBase*> ordered;
+   if(first < models.size()) ordered.push_back(models[first]);
+   for(size_t i=0; i<models.size(); i++) if(i != first) ordered.push_back(models[i]);
+   long next=0;
+   for(size_t i=0; i<ordered.size(); i++) {
+      fixedTerm t;
+      t.par = ordered[i]->par;
+      modelFixf* fx = dynamic_cast<modelFixf*>(ordered[i]);
+      modelFreg* rg = dynamic_cast<modelFreg*>(ordered[i]);
+      if(fx != 0) {
+         t.level = fx->F->data;
+         t.levelStart = &(fx->F->levelStart);
+         t.levelObs = &(fx->F->levelObs);
+         t.col.assign(fx->F->labels.size(), -1);
+         for(size_t lev=1; lev < t.col.size(); lev++)
+            if((*t.levelStart)[lev+1] > (*t.levelStart)[lev]) t.col[lev] = next++;
+         if(i==0) nsparse = size_t(next);
+      }
+      else {
+         if(rg != 0) t.covar = rg->C->data;
+         t.col.assign(1, next++);
+      }
+      terms.push_back(t);
+   }
+   ncoef = size_t(next);
+   ndense = ncoef - nsparse;
+   beta.resize(ncoef);
+   rhs.resize(ncoef);
+   wr.resize(nobs);
+   if(ndense > maxDense) {
+      Rbayz::Messages.push_back("Warning: joint_fixed is not used, there are " + std::to_string(ndense) +
+                                " fixed effects outside the largest fx() term (maximum " + std::to_string(maxDense) + ")");
+      return;
+   }
+   usable = factorize();
+   if(!usable)
+      Rbayz::Messages.push_back("Warning: joint_fixed is not used, X'X of the fixed effects is singular (confounded fx() or rg() terms?)");
+   factorVersion = rmod->varModel->weightsVersion;
+}
+
+// The coefficients in the dense block for one observation: dense column numbers and covariates.
+void jointFixedSampler::coefficients(size_t obs, std::vector<int> & cols, std::vector<double> & x) {
+   cols.clear();
+   x.clear();
+   for(size_t t = (nsparse > 0) ? 1 : 0; t < terms.size(); t++) {
+      long col = (terms[t].level == 0) ? terms[t].col[0] : terms[t].col[terms[t].level[obs]];
+      if(col < 0) continue;
+      cols.push_back(int(col - long(nsparse)));
+      x.push_back((terms[t].covar == 0) ? 1.0l : terms[t].covar[obs]);
+   }
+}
+
+// Build D, B and C for the relative weights and factorize; the Schur complement C - B D^-1 B' is
+// made in L22 and replaced by its Cholesky factor.
+bool jointFixedSampler::factorize() {
+   indepVarStr* residVar = respModel->varModel;
+   double scale = residVar->scaledWeights ? residVar->weightScale : 1.0l;
+   std::vector<int> cols;
+   std::vector<double> x;
+   double w;
+   C.assign(ndense*ndense, 0.0l);
+   for(size_t obs=0; obs < nobs; obs++) {
+      w = residPrec[obs] / scale;
+      coefficients(obs, cols, x);
+      for(size_t a=0; a < cols.size(); a++) {
+         for(size_t b=0; b < cols.size(); b++) {
+            if(cols[a] >= cols[b]) C[cols[a] + cols[b]*ndense] += w * x[a] * x[b];
+         }
+      }
+   }
+   D.assign(nsparse, 0.0l);
+   sqrtD.assign(nsparse, 0.0l);
+   Bstart.assign(nsparse+1, 0);
+   Brow.clear();
+   Bval.clear();
+   L22 = C;
+   if(nsparse > 0) {
+      std::vector<double> acc(ndense, 0.0l);
+      std::vector<int> touched;
+      std::vector<bool> isTouched(ndense, false);
+      const fixedTerm & sp = terms[0];
+      for(size_t lev=0; lev < sp.col.size(); lev++) {
+         if(sp.col[lev] < 0) continue;
+         size_t k = size_t(sp.col[lev]);
+         for(size_t j=(*sp.levelStart)[lev]; j < (*sp.levelStart)[lev+1]; j++) {
+            size_t obs = (*sp.levelObs)[j];
+            w = residPrec[obs] / scale;
+            D[k] += w;
+            coefficients(obs, cols, x);
+            for(size_t a=0; a < cols.size(); a++) {
+               if(!isTouched[cols[a]]) {
+                  isTouched[cols[a]] = true;
+                  touched.push_back(cols[a]);
+               }
+               acc[cols[a]] += w * x[a];
+            }
+         }
+         for(size_t a=0; a < touched.size(); a++) {
+            Brow.push_back(touched[a]);
+            Bval.push_back(acc[touched[a]]);
+            acc[touched[a]] = 0.0l;
+            isTouched[touched[a]] = false;
+         }
+         touched.clear();
+         Bstart[k+1] = Brow.size();
+         sqrtD[k] = std::sqrt(D[k]);
+         for(size_t a=Bstart[k]; a < Bstart[k+1]; a++) {
+            for(size_t b=Bstart[k]; b < Bstart[k+1]; b++) {
+               if(Brow[a] >= Brow[b]) L22[Brow[a] + Brow[b]*ndense] -= Bval[a] * Bval[b] / D[k];
+            }
+         }
+      }
+   }
+   if(ndense == 0) return true;
+   return blockChol(L22.data(), int(ndense));
+}
+
+void jointFixedSampler::sample() {
+   indepVarStr* residVar = respModel->varModel;
+   if(!residVar->scaledWeights && residVar->weightsVersion != factorVersion) {
+      if(!factorize()) throw generalRbayzError("X'WX of the fixed effects became singular in joint sampling");
+      factorVersion = residVar->weightsVersion;
+   }
+   double scale = residVar->scaledWeights ? residVar->weightScale : 1.0l;
+   size_t obs, k, a;
+   long col;
+   // current coefficients, and rhs = X'W resid + X'WX beta (relative weights)
+   for(size_t t=0; t < terms.size(); t++)
+      for(size_t lev=0; lev < terms[t].col.size(); lev++)
+         if(terms[t].col[lev] >= 0) beta[terms[t].col[lev]] = terms[t].par->val[lev];
+   for(obs=0; obs < nobs; obs++) wr[obs] = residPrec[obs] * resid[obs] / scale;
+   rhs.assign(ncoef, 0.0l);
+   for(size_t t=0; t < terms.size(); t++) {
+      const fixedTerm & term = terms[t];
+      if(term.level != 0) {
+         for(obs=0; obs < nobs; obs++) {
+            col = term.col[term.level[obs]];
+            if(col >= 0) rhs[col] += wr[obs];
+         }
+      }
+      else if(term.covar != 0) {
+         double sum=0.0l;
+         for(obs=0; obs < nobs; obs++) sum += term.covar[obs] * wr[obs];
+         rhs[term.col[0]] += sum;
+      }
+      else {
+         double sum=0.0l;
+         for(obs=0; obs < nobs; obs++) sum += wr[obs];
+         rhs[term.col[0]] += sum;
+      }
+   }
+   double* rhs2 = rhs.data() + nsparse;
+   const double* beta2 = beta.data() + nsparse;
+   for(k=0; k < nsparse; k++) {
+      rhs[k] += D[k] * beta[k];
+      for(a=Bstart[k]; a < Bstart[k+1]; a++) {
+         rhs[k] += Bval[a] * beta2[Brow[a]];
+         rhs2[Brow[a]] += Bval[a] * beta[k];
+      }
+   }
+   for(size_t j=0; j < ndense; j++) {
+      rhs2[j] += C[j + j*ndense] * beta2[j];
+      for(size_t i=j+1; i < ndense; i++) {
+         rhs2[i] += C[i + j*ndense] * beta2[j];
+         rhs2[j] += C[i + j*ndense] * beta2[i];
+      }
+   }
+   // forward solve L u = rhs, add N(0, 1/scale) deviates, back solve L' beta = u (in place in rhs)
+   for(k=0; k < nsparse; k++) {
+      rhs[k] /= sqrtD[k];
+      for(a=Bstart[k]; a < Bstart[k+1]; a++) rhs2[Brow[a]] -= Bval[a] / sqrtD[k] * rhs[k];
+   }
+   if(ndense > 0) blockCholForwardSolve(L22.data(), int(ndense), rhs2);
+   double sd = 1.0l / std::sqrt(scale);
+   for(k=0; k < ncoef; k++) rhs[k] += Rbayz::rng->rnorm(0.0l, sd);
+   if(ndense > 0) blockCholBackSolve(L22.data(), int(ndense), rhs2);
+   for(k=0; k < nsparse; k++) {
+      for(a=Bstart[k]; a < Bstart[k+1]; a++) rhs[k] -= Bval[a] / sqrtD[k] * rhs2[Brow[a]];
+      rhs[k] /= sqrtD[k];
+   }
+   // residuals for the change in the coefficients, and the new values in the parameter vectors
+   for(k=0; k < ncoef; k++) beta[k] = rhs[k] - beta[k];
+   for(size_t t=0; t < terms.size(); t++) {
+      const fixedTerm & term = terms[t];
+      if(term.level != 0) {
+         for(obs=0; obs < nobs; obs++) {
+            col = term.col[term.level[obs]];
+            if(col >= 0) resid[obs] -= beta[col];
+         }
+      }
+      else {
+         double delta = beta[term.col[0]];
+         if(term.covar != 0) for(obs=0; obs < nobs; obs++) resid[obs] -= delta * term.covar[obs];
+         else for(obs=0; obs < nobs; obs++) resid[obs] -= delta;
+      }
+      for(size_t lev=0; lev < term.col.size(); lev++)
+         term.par->val[lev] = (term.col[lev] >= 0) ? rhs[term.col[lev]] : 0.0l;
+   }
+}
@@ -0,0 +1,66 @@
+//
+//  jointFixedSampler.h
+//  Joint sampling of all fixed-effect coefficients (the mn(), fx() and rg() terms) from their full
+//  conditional, used with bayz(..., joint_fixed=TRUE) in place of the single-site updates in the
+//  sample() methods of these terms. Level 0 of every fx() term stays 0 (as in modelFixf) and is not
+//  in the system, as well as levels without data.
+//  The coefficients are ordered with the levels of the fx() term with most levels first (the sparse
+//  block, one coefficient per observation) and all other coefficients after that (the dense block).
+//  Then X'WX = [D B'; B C] where D is diagonal and B is sparse, and the Cholesky factor is
+//     L = [ D^1/2            0            ]
+//         [ B D^-1/2   chol(C - B D^-1 B') ]
+//  so only the Schur complement of the dense block is a dense matrix (a sparse Cholesky with a fixed
+//  ordering that has no fill in the first block).
+//  The factor is made for the relative residual weights: with scaled weights (IDEN and DIAG residual
+//  variance, see indepVarStr) it is made once and rescaled, otherwise it is made again when the
+//  residual variance model changes its weights. A draw is beta = L^-T (L^-1 rhs + z/sqrt(scale)).
+//
+
+#ifndef jointFixedSampler_h
+#define jointFixedSampler_h
+
+#include <vector>
+#include "modelBase.h"
+#include "modelResp.h"
+
+class jointFixedSampler {
+
+public:
+
+   // terms are the mn(), fx() and rg() model objects; after construction 'usable' is false when
+   // X'WX is singular (e.g. confounded fx() terms) or the dense block would be too large, with a
+   // warning in Rbayz::Messages.
+   jointFixedSampler(std::vector<modelBase*> & terms, modelResp* rmod);
+   void sample();
+   bool usable=false;
+
+private:
+
+   // column of every level of a fx() term (or the single column of mn() and rg()), -1 when not in
+   // the system; data is the level code (fx) or covariate (rg), both null for the mean.
+   struct fixedTerm {
+      parVector* par;
+      const int* level=0;
+      const double* covar=0;
+      std::vector<long> col;
+      const std::vector<size_t>* levelStart=0;
+      const std::vector<size_t>* levelObs=0;
+   };
+   std::vector<fixedTerm> terms;
+   modelResp* respModel;
+   double *resid, *residPrec;
+   size_t nobs, nsparse=0, ndense=0, ncoef=0;
+   std::vector<double> D, sqrtD;              // sparse block diagonal
+   std::vector<size_t> Bstart;                // B by sparse column: rows (dense index) and values
+   std::vector<int> Brow;
+   std::vector<double> Bval;
+   std::vector<double> C, L22;                // dense block and Cholesky factor of its Schur complement
+   std::vector<double> beta, rhs, wr;
+   unsigned long factorVersion=0;
+   bool factorize();
+   void coefficients(size_t obs, std::vector<int> & cols, std::vector<double> & x);
+   static const size_t maxDense=5000;
+
+};
+
+#endif /* jointFixedSampler_h */
@@ -21,9 +21,9 @@ public:
    labeledMatrix() : simpleMatrix() {  
    }
 
-   // constructor with an R matrix
+   // constructor with an R matrix, the matrix data is borrowed from R (not copied)
    labeledMatrix(Rcpp::RObject col, const std::string & name);
-   void addRowColNames(Rcpp::NumericMatrix M, const std::string & name);
+   void addRowColNames(SEXP M, const std::string & name);
    void addRowColNames(Rcpp::NumericMatrix M, const std::string & name, size_t useCol);
 
    // this is hiding the initWith methods from simpleMatrix class, and a labeledMatrix
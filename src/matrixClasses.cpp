@@ -2,6 +2,7 @@
 //  Code for labeledMatrix and kernelMatrix classes
 
 #include "kernelMatrix.h"
+#include "dataMatrix.h"
 #include "rbayzExceptions.h"
 #include "nameTools.h"
 
@@ -11,14 +12,14 @@
 // Throws errror if rownames not available, auto-fills colnames if colnames not available
 // This is now a member function of labeledMatrix, so that the object can call addRowNames
 // on itself to get its row or colnames filled.
-void labeledMatrix::addRowColNames(Rcpp::NumericMatrix M, const std::string & name) {
+void labeledMatrix::addRowColNames(SEXP M, const std::string & name) {
    rownames = getMatrixNames(M, 1);
    if(rownames.size()==0) {  // rownames empty not allowed
       throw generalRbayzError("No rownames on matrix " + name + "\n");
    }
    colnames = getMatrixNames(M, 2);
    if (colnames.size()==0) { // colnames empty, fill auto colnames
-      colnames = generateLabels("col",M.ncol());
+      colnames = generateLabels("col",Rf_ncols(M));
    }
 }
 
@@ -42,10 +43,14 @@ void labeledMatrix::addRowColNames(Rcpp::NumericMatrix M, const std::string & na
    }
 }
 
-labeledMatrix::labeledMatrix(Rcpp::RObject col, const std::string & name) : simpleMatrix(col) {
-   // Need to temporarily redo the conversion of the input Robject to
-   // Rcpp::NumericMatrix to retrieve row and col names.
+// The matrix data is not copied but borrowed from R (see simpleMatrix::borrowFrom), the conversion
+// to Rcpp::NumericMatrix is done once and also used to retrieve row and col names.
+labeledMatrix::labeledMatrix(Rcpp::RObject col, const std::string & name) : simpleMatrix() {
+   if(!Rf_isMatrix(col)) {
+      throw(generalRbayzError("Invalid matrix input in simpleMatrix constructor"));
+   }
    Rcpp::NumericMatrix Rmatrix = Rcpp::as<Rcpp::NumericMatrix>(col);
+   borrowFrom(Rmatrix);
    this->addRowColNames(Rmatrix, name);
 }
 
@@ -54,6 +59,137 @@ void labeledMatrix::initWith(Rcpp::NumericMatrix & M, const std::string & name,
    this->addRowColNames(M, name, useCol);
 }
 
+// ----------------- dataMatrix class --------------------
+
+dataMatrix::dataMatrix(Rcpp::RObject col, std::string & name) : labeledMatrix(), colCenter() {
+   if(loadSparse(col, name)) return;
+   if(!Rf_isMatrix(col)) {
+      throw(generalRbayzError("Invalid matrix input in simpleMatrix constructor"));
+   }
+   if(!packGenotypes(col)) {
+      // column-center the matrix data and fill missings with column mean.
+      Rcpp::NumericMatrix Rmatrix = Rcpp::as<Rcpp::NumericMatrix>(col);
+      borrowFrom(Rmatrix);
+      colCenter.initWith(ncol, 0.0l);
+      double * datacol;
+      size_t i,j, nobs;
+      double sum;
+      bool hasMissing=false;
+      for(i=0; i<ncol; i++) {
+         datacol = data[i];
+         sum=0.0l; nobs=0;
+         for(j=0; j<nrow; j++) {
+            if (! std::isnan(datacol[j]) ) {
+               sum+=datacol[j];
+               nobs++;
+            }
+         }
+         if(nobs < nrow) hasMissing=true;
+         colCenter[i] = sum / double(nobs);
+      }
+      if(hasMissing) {
+         makeOwnCopy();
+         for(i=0; i<ncol; i++) {
+            datacol = data[i];
+            for(j=0; j<nrow; j++)
+               if ( std::isnan(datacol[j])) datacol[j] = colCenter[i];
+         }
+      }
+   }
+   this->addRowColNames(col, name);
+}
+
+// Check if all values are 0/1/2/NA and if so store the matrix packed, codes 0,1,2 for the genotypes
+// and 3 for NA. Works directly on the R integer or double data, so that there is no conversion copy.
+bool dataMatrix::packGenotypes(Rcpp::RObject col) {
+   int type = TYPEOF(col);
+   if(type != INTSXP && type != REALSXP) return false;
+   size_t nr = Rf_nrows(col), nc = Rf_ncols(col), ntot = nr*nc;
+   if(nr==0 || nc==0) return false;
+   const int* ival = (type==INTSXP) ? INTEGER(col) : 0;
+   const double* dval = (type==REALSXP) ? REAL(col) : 0;
+   for(size_t i=0; i<ntot; i++) {
+      if(ival != 0) {
+         if(ival[i] != NA_INTEGER && (ival[i] < 0 || ival[i] > 2)) return false;
+      }
+      else if(!std::isnan(dval[i]) && dval[i] != 0.0l && dval[i] != 1.0l && dval[i] != 2.0l) return false;
+   }
+   nrow = nr; ncol = nc;
+   bytesPerCol = (nrow+3)/4;
+   genotypes.assign(bytesPerCol*ncol, 0);
+   decodeTable.resize(4*ncol);
+   colCenter.initWith(ncol, 0.0l);
+   for(size_t c=0; c<ncol; c++) {
+      unsigned char* g = &genotypes[c*bytesPerCol];
+      double sum=0.0l;
+      size_t nobs=0;
+      for(size_t r=0; r<nrow; r++) {
+         unsigned char code;
+         if(ival != 0) code = (ival[c*nrow+r]==NA_INTEGER) ? 3 : (unsigned char) ival[c*nrow+r];
+         else code = std::isnan(dval[c*nrow+r]) ? 3 : (unsigned char) dval[c*nrow+r];
+         g[r>>2] |= (unsigned char)(code << ((r & 3) << 1));
+         if(code < 3) {
+            sum += double(code);
+            nobs++;
+         }
+      }
+      colCenter[c] = sum/double(nobs);
+      double* table = &decodeTable[4*c];
+      table[0] = 0.0l; table[1] = 1.0l; table[2] = 2.0l; table[3] = colCenter[c];
+   }
+   packed = true;
+   return true;
+}
+
+// Sparse dgCMatrix: the column-compressed data is copied from the slots (row numbers, column starts
+// and values), missing values are replaced by the column mean (so they become zero after centering).
+// The column mean includes the zeros that are not stored.
+bool dataMatrix::loadSparse(Rcpp::RObject col, const std::string & name) {
+   if(!Rf_isS4(col) || !Rf_inherits(col, "dgCMatrix")) return false;
+   SEXP dim = R_do_slot(col, Rf_install("Dim"));
+   nrow = INTEGER(dim)[0];
+   ncol = INTEGER(dim)[1];
+   if(nrow==0 || ncol==0) {
+      throw(generalRbayzError("Zero or negative sizes in sparse matrix " + name));
+   }
+   SEXP pslot = R_do_slot(col, Rf_install("p"));
+   SEXP islot = R_do_slot(col, Rf_install("i"));
+   SEXP xslot = R_do_slot(col, Rf_install("x"));
+   sparseStart.assign(INTEGER(pslot), INTEGER(pslot)+ncol+1);
+   size_t nnz = size_t(sparseStart[ncol]);
+   sparseRow.assign(INTEGER(islot), INTEGER(islot)+nnz);
+   sparseVal.assign(REAL(xslot), REAL(xslot)+nnz);
+   colCenter.initWith(ncol, 0.0l);
+   for(size_t c=0; c<ncol; c++) {
+      double sum=0.0l;
+      size_t nmiss=0;
+      for(int k=sparseStart[c]; k<sparseStart[c+1]; k++) {
+         if(std::isnan(sparseVal[k])) nmiss++;
+         else sum += sparseVal[k];
+      }
+      colCenter[c] = sum / double(nrow-nmiss);
+      for(int k=sparseStart[c]; k<sparseStart[c+1]; k++)
+         if(std::isnan(sparseVal[k])) sparseVal[k] = colCenter[c];
+   }
+   SEXP dimnames = R_do_slot(col, Rf_install("Dimnames"));
+   if(Rf_isNull(VECTOR_ELT(dimnames, 0))) {
+      throw generalRbayzError("No rownames on matrix " + name + "\n");
+   }
+   CharVec2cpp(rownames, Rcpp::CharacterVector(VECTOR_ELT(dimnames, 0)));
+   if(Rf_isNull(VECTOR_ELT(dimnames, 1))) colnames = generateLabels("col", ncol);
+   else CharVec2cpp(colnames, Rcpp::CharacterVector(VECTOR_ELT(dimnames, 1)));
+   decoded.resize(nrow);
+   sparse = true;
+   return true;
+}
+
+void dataMatrix::decodeColumn(size_t col) {
+   std::fill(decoded.begin(), decoded.end(), 0.0l);
+   for(int k=sparseStart[col]; k<sparseStart[col+1]; k++)
+      decoded[sparseRow[k]] = sparseVal[k];
+   decodedCol = col;
+}
+
 // ----------------- kernelMatrix class --------------------
 
 // kernelMatrix constructor with no dim_pct setting, this calls the other constructor,
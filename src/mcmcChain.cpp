@@ -0,0 +1,534 @@
+//
+//  mcmcChain.cpp
+//
+
+#include <vector>
+#include <string>
+#include <Rcpp.h>
+#include <cmath>
+#include "Rbayz.h"
+#include "mcmcChain.h"
+#include "parsedModelTerm.h"
+#include "modelBase.h"
+#include "modelCoeff.h"
+#include "modelResp.h"
+#include "modelMean.h"
+#include "modelFixf.h"
+#include "modelRanfi.h"
+#include "modelFreg.h"
+#include "modelRreg.h"
+#include "modelRanfc.h"
+#include "modelMixt.h"
+#include "rbayzExceptions.h"
+#include "checkpointTools.h"
+#include <stdio.h>
+
+mcmcChain::mcmcChain(int chainNr, uint64_t seed) : chainNumber(chainNr), rng(seed, uint64_t(chainNr)) {
+}
+
+mcmcChain::~mcmcChain() {
+   if(jointSampler != 0) delete jointSampler;
+   if(modelR != 0) delete modelR;
+   for(size_t i=0; i<model.size(); i++) delete model[i];
+}
+
+// Build vector of modelling objects from the model terms; modelTerms[0] is the response.
+// The model-objects add their parameter vectors to the global Rbayz::parList from the
+// modelBase constructor; here it is cleared first and at the end the list is copied in the chain.
+void mcmcChain::buildModel(std::vector<std::string> & modelTerms, std::string & VEstr, int verbose) {
+
+   Rbayz::parList.clear();
+   Rbayz::rng = &rng;     // some constructors may already draw random numbers
+
+   // build response object - including response variance structure
+   parsedModelTerm parsedResponseVariable(modelTerms[0], VEstr);
+   // here still need to add selecting different response objects based on variance structure
+   modelR = new modelResp(parsedResponseVariable);
+   if (verbose > 1) Rcpp::Rcout << "Response model-object done\n";
+
+   // Build vector of modelling objects from RHS terms (loop from term=1)
+   if(verbose>2) Rcpp::Rcout << "Starting on building model objects ...\n";
+   for(size_t term=1; term<modelTerms.size(); term++) {
+      parsedModelTerm pmt(modelTerms[term]);
+      if(verbose>2) Rcpp::Rcout << " ... building term " << term << " " << pmt.funcName << "()\n";
+      if(pmt.funcName=="mn") {
+         if(pmt.variableString=="1") model.push_back(new modelMean(pmt, modelR));
+      }
+      else if(pmt.funcName=="fx") {
+         model.push_back(new modelFixf(pmt, modelR));
+      }
+      else if(pmt.funcName=="rn") {
+         if(pmt.varianceStruct=="IDEN" || pmt.varianceStruct=="notgiven") {
+            model.push_back(new modelRanfi_iden(pmt, modelR));
+         }
+         else if (pmt.varianceStruct=="1kernel") {
+            model.push_back(new modelRanfc1(pmt, modelR));
+         }
+         else if (pmt.varianceStruct=="kernels") {
+            // Here default should become not merging kernels, unless user specified merging.
+            // However, the code for not merging is not yet ready, so for now force merging.
+            // [ToDo] finish the code for not merging kernels in modelRanfck.
+//            if (pmt.allOptions["mergeKernels"].isgiven && pmt.allOptions["mergeKernels"].valbool)
+               model.push_back(new modelRanfc1(pmt, modelR));
+//            else
+//               model.push_back(new modelRanfck(pmt, modelR));
+         }
+         else {
+            throw generalRbayzError("There is no class to model rn(...) with Variance structure " + pmt.allOptions["V"].valstring);
+         }
+      }
+      else if (pmt.funcName=="rr") {
+         // Note: varianceStruct DIAG, LASS, MIXT are always single (for now) - see parsedModelTerm.
+         //       If there would be multiple with a DIAG it would be annotated as "mixed" varianceStruct.
+         if(pmt.varianceStruct=="IDEN" || pmt.varianceStruct=="notgiven")
+            model.push_back(new modelRregIden(pmt, modelR));
+         else if (pmt.varianceStruct=="DIAG")
+            model.push_back(new modelRregDiag(pmt, modelR));
+         else if (pmt.varianceStruct=="LASS")
+            model.push_back(new modelRregGRL(pmt, modelR));
+         else if (pmt.varianceStruct=="MIXT") {
+            modelRregMixt* rrmodel = new modelRregMixt(pmt, modelR);
+            model.push_back(rrmodel);
+            model.push_back(new modelMixt(pmt, rrmodel));
+         }
+         else
+            throw generalRbayzError("There is no class to model rr(...) with Variance structure " + pmt.allOptions["V"].valstring);
+      }
+      else if (pmt.funcName=="rg") {    // [ToDo] work on adding rg() versions
+         if(pmt.variablePattern=="onevar")
+            model.push_back(new modelFreg(pmt, modelR));
+//         else if (pmt.variablePattern="nestedreg")
+//          need a new model object for the nested regression
+         else
+            throw generalRbayzError("Regression with the variable syntax " + pmt.variableString + " not yet supported\n");
+      }
+      else {
+        throw generalRbayzError("Unknown model-function \'" + pmt.funcName + "\' at "+pmt.shortModelTerm);
+      }
+   } // end for(term ...) to build model
+
+   parList = Rbayz::parList;
+   if(jointFixed) setupJointFixed();
+
+}
+
+// The joint sampler is used when there are at least two fixed-effect terms and X'X can be factorized,
+// otherwise the terms keep their own updates (there is a warning from the jointFixedSampler).
+void mcmcChain::setupJointFixed() {
+   std::vector<modelBase*> fixedTerms;
+   inJoint.assign(model.size(), false);
+   for(size_t mt=0; mt<model.size(); mt++) {
+      if(dynamic_cast<modelMean*>(model[mt]) != 0 || dynamic_cast<modelFixf*>(model[mt]) != 0 ||
+         dynamic_cast<modelFreg*>(model[mt]) != 0) {
+         fixedTerms.push_back(model[mt]);
+         inJoint[mt] = true;
+      }
+   }
+   if(fixedTerms.size() > 1) jointSampler = new jointFixedSampler(fixedTerms, modelR);
+   if(jointSampler == 0 || !jointSampler->usable) {
+      delete jointSampler;
+      jointSampler = 0;
+      inJoint.assign(model.size(), false);
+   }
+}
+
+// Load initial values if given. An easy start is to only allow init-values from a run
+// with the same model - so that parameter-names and sizes all align.
+void mcmcChain::loadInitValues(Rcpp::List & initVals) {
+   Rcpp::DataFrame old_parameters = Rcpp::as<Rcpp::DataFrame>(initVals["Parameters"]);
+   Rcpp::CharacterVector old_par_names = old_parameters["Param"];
+   Rcpp::IntegerVector old_par_sizes = old_parameters["Size"];
+   // check alignment of names and sizes between old and current build model
+   bool match=true;
+   if((size_t) old_par_sizes.size() == parList.size()){
+      for(size_t i=0; i<parList.size(); i++) {
+         if( ! (old_par_names[i] == (*(parList[i]))->Name &&
+                  (size_t) old_par_sizes[i] == (*(parList[i]))->nelem) ) match=false;
+      }
+   }
+   else
+      match=false;
+   if(match) {
+      Rcpp::List old_estimates = initVals["Estimates"];
+      for(size_t par=0; par<parList.size(); par++) {                     // for now loading fitted values from Estimates list,
+         Rcpp::DataFrame par_data = Rcpp::as<Rcpp::DataFrame>(old_estimates[par]);    // but they are also stored in Residuals.
+         Rcpp::NumericVector par_pm = par_data["PostMean"];
+         for(size_t row=0; row < (*(parList[par]))->nelem; row++)
+            (*(parList[par]))->val[row] = par_pm[row];
+      }
+      modelR->readjResid();  // residuals need to be reset to match loaded fitted values.
+      modelR->restart();
+      for(size_t mod=0; mod<model.size(); mod++) model[mod]->restart();
+   }
+   else {  // no match
+      throw (generalRbayzError("Initialisation values cannot be used because names or sizes don't match"));
+   }      // this could also be a warning, but there is no nice way to count and handle warnings
+}
+
+void mcmcChain::prepareRun(int chLength, int chBurnIn, int chSkip, size_t nOutput, bool traceFloat,
+                           double traceLimitMB, std::string traceFile) {
+   chainLength = chLength;
+   burnIn = chBurnIn;
+   skip = chSkip;
+   nSamples = nOutput;
+   tracedPtr.clear();
+   for(size_t i=0; i<parList.size(); i++) {
+      if( (*(parList[i]))->traced ) {
+         for(size_t j=0; j< (*(parList[i]))->nelem; j++) tracedPtr.push_back( &((*(parList[i]))->val[j]) );
+      }
+   }
+   nTracedParam = tracedPtr.size();
+   traces.init(nSamples, nTracedParam, traceFloat, traceLimitMB, traceFile);
+   monitor.init(nTracedParam);
+   setupTimers();
+}
+
+void mcmcChain::setupTimers() {
+   const char* termPhases[3] = {"sample", "sampleHpars", "prepForOutput"};
+   const char* parPhases[2] = {"collectStats", "writeSamples"};
+   timers.clear();
+   for(size_t t=0; t<=model.size(); t++) {
+      modelBase* term = (t==0) ? (modelBase*) modelR : model[t-1];
+      phaseTimer tm;
+      tm.term = (t==0) ? "response" : term->par->modelFunction + "(" + term->par->variables + ")";
+      modelCoeff* coeffTerm = dynamic_cast<modelCoeff*>(term);
+      tm.nobs = (coeffTerm != 0) ? coeffTerm->Nresid : term->par->nelem;
+      for(int phase=0; phase<3; phase++) {
+         tm.phase = termPhases[phase];
+         timers.push_back(tm);
+      }
+   }
+   for(size_t i=0; i<parList.size(); i++) {
+      phaseTimer tm;
+      tm.term = (*(parList[i]))->Name;
+      tm.nobs = (*(parList[i]))->nelem;
+      for(int phase=0; phase<2; phase++) {
+         tm.phase = parPhases[phase];
+         timers.push_back(tm);
+      }
+   }
+}
+
+// add time since t to a timer and reset t to now, so that consecutive calls need one clock reading
+void mcmcChain::addTime(size_t timer, std::chrono::steady_clock::time_point & t) {
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+   timers[timer].seconds += std::chrono::duration<double>(now - t).count();
+   timers[timer].calls++;
+   t = now;
+}
+
+// Run the MCMC chain for method "Bayes" and "BLUPMC"
+// Only the chain running in the main thread (chain 0) can print on the R console.
+void mcmcChain::run(std::string method, int verbose) {
+
+   Rbayz::rng = &rng;
+
+   // to show convergence set "nShow" interval and make vector to hold previously shown solutions
+   int nShow = chainLength/10;
+   if( nShow < 1) nShow=1;
+   int collect_first_conv = chainLength/20;
+   if (collect_first_conv < 1) collect_first_conv=1;
+   std::vector<double> prevShowConv(nTracedParam, 0.5l);
+   std::vector<double> tracedNow(nTracedParam);
+   bool useTargets = (targetEss > 0 || targetMcse > 0);
+   if (startCycle >= collect_first_conv) {      // resumed chain, start showing from current values
+      for(size_t i=0, col=0; i<parList.size(); i++) {
+         if( (*(parList[i]))->traced ) {
+            for(size_t j=0; j< (*(parList[i]))->nelem; j++) {
+               prevShowConv[col] = (*(parList[i]))->val[j];
+               col++;
+            }
+         }
+      }
+   }
+
+   if(verbose>0) {
+      if(useTargets) Rcpp::Rcout << "Cycle avgChange minESS\n";
+      else Rcpp::Rcout << "Cycle avgChange\n";
+   }
+   nSaved = startSave;
+   lastCycle = startCycle;
+   bool stopNow = false;
+   size_t parTimers = 3*(model.size()+1);      // first timer index for the parameter-vectors
+   std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now(), t;
+   for (int cycle=startCycle+1, save=startSave; cycle <= chainLength && !stopNow; cycle++) {
+      t = std::chrono::steady_clock::now();
+      modelR->sample();
+      addTime(0, t);
+      for(size_t mt=0, firstJoint=1; mt<model.size(); mt++) {
+         if(jointSampler != 0 && inJoint[mt]) {
+            if(firstJoint) jointSampler->sample();
+            firstJoint=0;
+         }
+         else model[mt]->sample();
+         addTime(3*(mt+1), t);
+      }
+      if(method=="Bayes") {
+         modelR->sampleHpars();
+         addTime(1, t);
+         for(size_t mt=0; mt<model.size(); mt++) {
+            model[mt]->sampleHpars();
+            addTime(3*(mt+1)+1, t);
+         }
+      }
+      // At the 'skip' intervals and after burn-in:
+      // 1) update posterior statistics using collectStats();
+      // 2) save MCMC samples in memory for the 'traced' parameters;
+      // 3) save MCMC samples on disk for parameters with 'saveSamples' option
+      if ( (cycle > burnIn) && (cycle % skip == 0) ) {
+         t = std::chrono::steady_clock::now();
+         for(size_t mt=0; mt<model.size(); mt++) {
+            model[mt]->prepForOutput();
+            addTime(3*(mt+1)+2, t);
+         }
+         for(size_t i=0; i<parList.size(); i++) {
+            (*(parList[i]))->collectStats();
+            addTime(parTimers+2*i, t);
+         }
+         for(size_t col=0; col<nTracedParam; col++) tracedNow[col] = *(tracedPtr[col]);
+         traces.setRow(save, tracedNow.data());
+         for(size_t i=0; i<parList.size(); i++) {
+            if( (*(parList[i]))->saveSamples ) {
+               t = std::chrono::steady_clock::now();
+               (*(parList[i]))->writeSamples(cycle);
+               addTime(parTimers+2*i+1, t);
+            }
+         }
+         save++;  // save is counter for output (saved) cycles
+         monitor.add(tracedNow.data());
+         if(useTargets && monitor.reachedTargets(targetEss, targetMcse)) stopNow=true;
+      }
+      nSaved = save;
+      lastCycle = cycle;
+      // at 'collect_first_conv' cycle store parameter values in prevShowConv to allow computing
+      // first convergence; then at 'nShow' intervals show convergence on screen (when verbose > 0).
+      if (cycle == collect_first_conv) {
+         for(size_t i=0, col=0; i<parList.size(); i++) {
+            if( (*(parList[i]))->traced ) {
+               for(size_t j=0; j< (*(parList[i]))->nelem; j++) {
+                  prevShowConv[col] = (*(parList[i]))->val[j];
+                  col++;
+               }
+            }
+         }
+      }
+      if (cycle % nShow == 0 && verbose>0) {
+         Rcpp::Rcout << cycle;
+         double conv_change=0.0l, conv_denom=0.0l, postmean;
+         for(size_t i=0, col=0; i<parList.size(); i++) {
+            if( (*(parList[i]))->traced ) {
+               for(size_t j=0; j< (*(parList[i]))->nelem; j++) {
+                  if (save==0) postmean = (*(parList[i]))->val[j];  // if nothing saved yet, using sampled
+                  else postmean = (*(parList[i]))->postMean[j];     // value instead of postmean.
+                  conv_change += std::abs(prevShowConv[col] - postmean);
+                  conv_denom += std::abs(prevShowConv[col]);
+                  prevShowConv[col] = postmean;
+                  col++;
+               }
+            }
+         }
+         conv_change /= conv_denom;
+         Rcpp::Rcout << " " << conv_change;
+         if(useTargets) {
+            double minEss = (nTracedParam>0) ? monitor.ess(0) : 0.0l;
+            for(size_t col=1; col<nTracedParam; col++) if(monitor.ess(col) < minEss) minEss=monitor.ess(col);
+            Rcpp::Rcout << " " << minEss;
+         }
+         Rcpp::Rcout << "\n";
+      }
+      if(stopNow && verbose>0) Rcpp::Rcout << "Stopping at cycle " << cycle << ", convergence targets reached\n";
+      if (checkpointInterval > 0 && (cycle % checkpointInterval == 0 || cycle == chainLength || stopNow))
+         saveCheckpoint(cycle, save);
+   } // end for(cycle ...)
+   runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+   traces.finish(size_t(nSaved));
+   for(size_t i=0; i<parList.size(); i++) (*(parList[i]))->finishSamples();
+
+}
+
+// Variational Bayes (method "VB") with a mean-field approximation where every coefficient and every
+// variance has its own factor. The coordinate updates use the same sample() and sampleHpars() code as
+// the MCMC, with the random number generator in expectation mode: coefficients get their conditional
+// mean given the current means of all others, with the conditional variance stored in vbVar (see
+// modelCoeff::sampleCoeff), and variances are updated as ssq/df, which is 1/E[1/var] under the
+// inverse-gamma factor when ssq includes the posterior variances (see idenVarStr::sample). For the
+// residual variance the posterior variances of the residuals are approximated from the effective
+// number of parameters (modelResp::vbResidVar). Iterations stop when the relative change in all
+// parameter values is below vbTolerance; the posterior means are the final values and the posterior
+// variances of coefficients are in vbVar (zero for variance parameters).
+void mcmcChain::runVB(int verbose) {
+
+   Rbayz::rng = &rng;
+   rng.expectation = true;
+   for(size_t mt=0; mt<model.size(); mt++) {
+      if(!model[mt]->vbAvailable())
+         throw generalRbayzError("Method VB is not available for model term with parameters " + model[mt]->par->Name);
+   }
+   for(size_t i=0; i<parList.size(); i++) (*(parList[i]))->vbVar.assign((*(parList[i]))->nelem, 0.0l);
+   std::vector<double> prevValues;
+   for(size_t i=1; i<parList.size(); i++)
+      for(size_t j=0; j< (*(parList[i]))->nelem; j++) prevValues.push_back((*(parList[i]))->val[j]);
+   if(verbose>0) Rcpp::Rcout << "Iteration relChange\n";
+   std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now(), t;
+   double change=1.0l;
+   lastCycle = 0;
+   for (int iter=1; iter <= chainLength && change > vbTolerance; iter++) {
+      t = std::chrono::steady_clock::now();
+      modelR->sample();
+      addTime(0, t);
+      for(size_t mt=0; mt<model.size(); mt++) {
+         model[mt]->sample();
+         addTime(3*(mt+1), t);
+      }
+      double peff=0.0l;
+      for(size_t mt=0; mt<model.size(); mt++) {
+         modelCoeff* coeffModel = dynamic_cast<modelCoeff*>(model[mt]);
+         if(coeffModel != 0) peff += coeffModel->vbEffectiveN();
+      }
+      modelR->vbResidVar(peff);
+      modelR->sampleHpars();
+      addTime(1, t);
+      for(size_t mt=0; mt<model.size(); mt++) {
+         model[mt]->sampleHpars();
+         addTime(3*(mt+1)+1, t);
+      }
+      // relative change in all parameters except fitted values (parList[0])
+      double sumChange=0.0l, sumAbs=0.0l;
+      for(size_t i=1, col=0; i<parList.size(); i++) {
+         for(size_t j=0; j< (*(parList[i]))->nelem; j++, col++) {
+            sumChange += std::abs((*(parList[i]))->val[j] - prevValues[col]);
+            sumAbs += std::abs((*(parList[i]))->val[j]);
+            prevValues[col] = (*(parList[i]))->val[j];
+         }
+      }
+      change = (sumAbs > 0.0l) ? sumChange/sumAbs : 0.0l;
+      lastCycle = iter;
+      if(verbose>0 && (iter <= 10 || iter % 10 == 0 || change <= vbTolerance))
+         Rcpp::Rcout << iter << " " << change << "\n";
+   }
+   if(change > vbTolerance)
+      Rbayz::Messages.push_back("Warning: VB did not converge in " + std::to_string(chainLength) + " iterations");
+   for(size_t mt=0; mt<model.size(); mt++) model[mt]->prepForOutput();
+   for(size_t i=0; i<parList.size(); i++) {
+      parVector* p = *(parList[i]);
+      for(size_t j=0; j<p->nelem; j++) {
+         p->postMean[j] = p->val[j];
+         p->postVar[j] = p->vbVar[j];
+      }
+      p->count_collect_stats = 1;
+   }
+   rng.expectation = false;
+   runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+   traces.finish(0);
+
+}
+
+void mcmcChain::runSafely(std::string method, int verbose) {
+   try {
+      if(method=="VB") runVB(verbose);
+      else run(method, verbose);
+   }
+   catch (std::exception &err) {
+      errorMessage = "Error in chain " + std::to_string(chainNumber+1) + ": " + std::string(err.what());
+   }
+   catch (...) {
+      errorMessage = "An unknown error occured in chain " + std::to_string(chainNumber+1);
+   }
+}
+
+// Merging posterior statistics of all chains in the parVectors of the first chain, using the
+// standard formulas to combine means and sums of squared deviations from independent sets.
+// All chains have the same model, so the parLists align.
+void mergeChainStats(std::vector<mcmcChain *> & chains) {
+   if(chains.size() < 2) return;
+   std::vector<parVector**> & mergedList = chains[0]->parList;
+   for(size_t c=1; c<chains.size(); c++) {
+      for(size_t i=0; i<mergedList.size(); i++) {
+         parVector* p0 = *(mergedList[i]);
+         parVector* pc = *(chains[c]->parList[i]);
+         double n0 = double(p0->count_collect_stats);
+         double nc = double(pc->count_collect_stats);
+         double n = n0 + nc;
+         if(nc==0) continue;
+         for(size_t j=0; j<p0->nelem; j++) {
+            double delta = pc->postMean[j] - p0->postMean[j];
+            p0->postMean[j] += delta * nc / n;
+            p0->sumSqDiff[j] += pc->sumSqDiff[j] + delta * delta * n0 * nc / n;
+            p0->postVar[j] = (n > 1) ? p0->sumSqDiff[j]/(n-1.0l) : 0.0l;
+         }
+         p0->count_collect_stats += pc->count_collect_stats;
+      }
+   }
+}
+
+// The checkpoint file has: a header with the chain settings and the cycle number reached, the state
+// of the random number generator, all parameter-vectors (with posterior statistics), internal state
+// of the model objects and the traced samples collected so far. It is first written to a temporary
+// file, so that an interruption while writing does not destroy the previous checkpoint.
+void mcmcChain::saveCheckpoint(int cycle, int save) {
+   std::string tempFile = checkpointFile + ".tmp";
+   FILE* f = fopen(tempFile.c_str(), "wb");
+   if(f==0) throw generalRbayzError("Unable to open checkpoint file " + tempFile);
+   try {
+      writeStateString(f, "Rbayz checkpoint 1");
+      int header[6] = {chainNumber, cycle, save, chainLength, burnIn, skip};
+      writeState(f, header, 6);
+      rng.saveState(f);
+      size_t npar = parList.size();
+      writeState(f, &npar, 1);
+      for(size_t i=0; i<parList.size(); i++) (*(parList[i]))->saveState(f);
+      modelR->saveState(f);
+      for(size_t mt=0; mt<model.size(); mt++) model[mt]->saveState(f);
+      monitor.saveState(f);
+      writeState(f, &nTracedParam, 1);
+      traces.saveState(f, size_t(save));
+   }
+   catch (...) {      // also e.g. bad_alloc from a corrupt length, the file must not stay open
+      fclose(f);
+      throw;
+   }
+   if(fclose(f) != 0) throw generalRbayzError("Error writing checkpoint file " + tempFile);
+   remove(checkpointFile.c_str());
+   if(rename(tempFile.c_str(), checkpointFile.c_str()) != 0)
+      throw generalRbayzError("Unable to rename " + tempFile + " to " + checkpointFile);
+}
+
+// Loading a checkpoint needs the chain built with the same model, and prepareRun() done with the same
+// burn-in and skip; the chain length can be longer to extend a chain that was completed before.
+void mcmcChain::loadCheckpoint() {
+   FILE* f = fopen(checkpointFile.c_str(), "rb");
+   if(f==0) throw generalRbayzError("Unable to open checkpoint file " + checkpointFile + " to resume");
+   try {
+      if(readStateString(f) != "Rbayz checkpoint 1")
+         throw generalRbayzError("File " + checkpointFile + " is not an Rbayz checkpoint file");
+      int header[6];
+      readState(f, header, 6);
+      if(header[0] != chainNumber)
+         throw generalRbayzError("Checkpoint file " + checkpointFile + " is from another chain");
+      if(header[4] != burnIn || header[5] != skip)
+         throw generalRbayzError("Resuming needs the same burn-in and skip as in the checkpointed run");
+      if(header[1] > chainLength)
+         throw generalRbayzError("The chain length is shorter than the cycle reached in the checkpoint");
+      startCycle = header[1];
+      startSave = header[2];
+      rng.loadState(f);
+      size_t npar;
+      readState(f, &npar, 1);
+      if(npar != parList.size())
+         throw generalRbayzError("Checkpoint file does not match the model: number of parameters is different");
+      for(size_t i=0; i<parList.size(); i++) (*(parList[i]))->loadState(f);
+      modelR->loadState(f);
+      for(size_t mt=0; mt<model.size(); mt++) model[mt]->loadState(f);
+      monitor.loadState(f);
+      size_t ntraced;
+      readState(f, &ntraced, 1);
+      if(ntraced != nTracedParam)
+         throw generalRbayzError("Checkpoint file does not match the model: traced parameters are different");
+      traces.loadState(f, size_t(startSave));
+   }
+   catch (...) {      // also e.g. bad_alloc from a corrupt length, the file must not stay open
+      fclose(f);
+      throw;
+   }
+   fclose(f);
+}
@@ -0,0 +1,103 @@
+//
+//  mcmcChain.h
+//  One replica of the complete model (response model, explanatory model-terms and the list of
+//  parameter vectors) with the code to run MCMC cycles on it. rbayz_cpp builds one mcmcChain
+//  for every chain requested with nchains=, and runs the chains in parallel threads.
+//  Everything that changes while running is inside the chain object (parameter values, posterior
+//  statistics, traced samples, random number generator), so running chains do not share any state.
+//  Note: building the model uses R (retrieving variables, eigen() for kernels, etc.) and must be done
+//  in the main thread, one chain after the other. Only run() can go in a separate thread, and
+//  therefore run() and all sample() methods should not use R or Rcpp functions.
+//
+
+#ifndef mcmcChain_h
+#define mcmcChain_h
+
+#include <Rcpp.h>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <chrono>
+#include "Rbayz.h"
+#include "modelBase.h"
+#include "modelResp.h"
+#include "parVector.h"
+#include "rbayzRNG.h"
+#include "convergenceMonitor.h"
+#include "traceStore.h"
+#include "jointFixedSampler.h"
+
+// accumulated wall time of one phase (sample, sampleHpars, ...) of one model term or parameter
+struct phaseTimer {
+   std::string term, phase;
+   size_t nobs=0, calls=0;
+   double seconds=0.0;
+};
+
+class mcmcChain {
+
+public:
+
+   // all chains get the same seed, the chain number is used as the random number stream
+   mcmcChain(int chainNr, uint64_t seed);
+   ~mcmcChain();
+
+   // building model objects from the (split) model terms, it fills the chain's parList.
+   void buildModel(std::vector<std::string> & modelTerms, std::string & VEstr, int verbose);
+   // load values from a previous bayz output (needs the same model)
+   void loadInitValues(Rcpp::List & initVals);
+   // allocate storage for traced samples, needs number of output samples from the chain settings,
+   // the trace precision and the memory limit before traces are stored in a file (see traceStore).
+   void prepareRun(int chainLength, int burnIn, int skip, size_t nOutput, bool traceFloat,
+                   double traceLimitMB, std::string traceFile);
+   // run() is the MCMC loop, runSafely() is a wrapper that catches errors to store them in
+   // errorMessage, because exceptions cannot pass from a thread back to the main thread.
+   void run(std::string method, int verbose);
+   void runSafely(std::string method, int verbose);
+   // runVB() is method "VB": at most chainLength iterations of deterministic (mean-field) updates,
+   // stopping when the relative change in the parameters is below vbTolerance.
+   void runVB(int verbose);
+   double vbTolerance=1e-6;
+   // write all state to checkpointFile (every checkpointInterval cycles and at the end when
+   // checkpointInterval>0), and read it back to resume: the chain then continues from startCycle.
+   void saveCheckpoint(int cycle, int save);
+   void loadCheckpoint();
+
+   // with jointFixed (bayz(..., joint_fixed=TRUE)) the mn(), fx() and rg() terms, marked in inJoint,
+   // are sampled together by jointSampler at the place of the first of these terms.
+   void setupJointFixed();
+   bool jointFixed=false;
+   jointFixedSampler* jointSampler=0;
+   std::vector<bool> inJoint;
+
+   int chainNumber;
+   int chainLength=0, burnIn=0, skip=1;
+   modelResp* modelR=0;
+   std::vector<modelBase *> model;
+   std::vector<parVector**> parList;
+   size_t nTracedParam=0, nSamples=0;
+   traceStore traces;                    // nSamples x nTracedParam
+   std::vector<double*> tracedPtr;       // pointers to the nTracedParam traced values
+   rbayzRNG rng;
+   std::string errorMessage="";
+   int checkpointInterval=0;
+   std::string checkpointFile="";
+   int startCycle=0, startSave=0;
+   // online convergence monitor on the traced parameters; with targets > 0 the chain stops when
+   // all traced parameters reach them. nSaved and lastCycle are the samples and cycles done.
+   convergenceMonitor monitor;
+   double targetEss=0, targetMcse=0;
+   int nSaved=0, lastCycle=0;
+   // timers for every model term (response model first) for sample, sampleHpars and prepForOutput,
+   // followed by timers for every parameter-vector for collectStats and writeSamples.
+   std::vector<phaseTimer> timers;
+   double runSeconds=0.0;
+   void setupTimers();
+   void addTime(size_t timer, std::chrono::steady_clock::time_point & t);
+
+};
+
+// combine posterior statistics from all chains in the parVectors of the first chain.
+void mergeChainStats(std::vector<mcmcChain *> & chains);
+
+#endif /* mcmcChain_h */
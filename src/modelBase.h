@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include "Rbayz.h"
 #include "parVector.h"
+#include "checkpointTools.h"
 //#include <unistd.h>
 
 class modelBase {
@@ -38,6 +39,16 @@ public:
    // parameters for output, the base class defines an 'empty' version.
    virtual void prepForOutput() { };
 
+   // saveState and loadState are for checkpointing: they write and read internal state that
+   // is needed to continue a chain, other than the parameter-vectors (these are in parList).
+   // The base class defines 'empty' versions for classes that have no other state.
+   virtual void saveState(FILE* f) { };
+   virtual void loadState(FILE* f) { };
+
+   // Model classes that can run with method "VB" (their sample() methods draw coefficients with
+   // modelCoeff::sampleCoeff) return true.
+   virtual bool vbAvailable() { return false; }
+
    parVector* par=0;
 
 };
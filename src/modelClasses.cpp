@@ -156,6 +156,9 @@ modelRanfc1::modelRanfc1(parsedModelTerm & modeldescr, modelResp * rmod)
    // in the sample code it is already removed.
    builObsIndex(obsIndex,F,K);
 
+   // with precision=float the eigenvectors are stored in float to halve memory and bandwidth
+   if(floatPrecision(modeldescr)) K->convertToFloat();
+
    // [ToDo] create the variance object - may need to move out as in ranfi when allowing for
    // different variance structures. But this is the variance structure for the alpha coefficients,
    // and there is no interface yet to allow different structures here...
@@ -168,14 +171,20 @@ modelRanfc1::~modelRanfc1() {
 }
 
 void modelRanfc1::sample() {
-   // Update regressions on the eigenvectors
+   if(K->useFloat) sampleRegressions(K->fdata);
+   else sampleRegressions(K->data);
+}
+
+// Update regressions on the eigenvectors, the eigenvectors can be stored as double or float
+// (precision=float option), lhs and rhs are always accumulated in double.
+template<typename T> void modelRanfc1::sampleRegressions(T** columns) {
    double lhsl, rhsl;
    size_t matrixrow;
-   double* colptr;
+   const T* colptr;
    for (size_t obs=0; obs < F->nelem; obs++)
       fit.data[obs] = 0.0l;
    for(size_t col=0; col < K->ncol; col++) {
-      colptr = K->data[col];
+      colptr = columns[col];
       // residual de-correction for this evec column
       for (size_t obs=0; obs < F->nelem; obs++)
          resid[obs] += regcoeff->val[col] * colptr[F->data[obs]];
@@ -183,12 +192,12 @@ void modelRanfc1::sample() {
       lhsl = 0.0l; rhsl=0.0l;
       for (size_t obs=0; obs < F->nelem; obs++) {
          matrixrow = F->data[obs];
-         rhsl += colptr[matrixrow] * residPrec[obs] * (resid[obs]-fit.data[obs]);
-         lhsl += colptr[matrixrow] * colptr[matrixrow] * residPrec[obs];
+         rhsl += double(colptr[matrixrow]) * residPrec[obs] * (resid[obs]-fit.data[obs]);
+         lhsl += double(colptr[matrixrow]) * colptr[matrixrow] * residPrec[obs];
       }
 
       lhsl += varmodel->weights[col];
-      regcoeff->val[col] = R::rnorm( (rhsl/lhsl), sqrt(1.0/lhsl));
+      regcoeff->val[col] = Rbayz::rng->rnorm( (rhsl/lhsl), sqrt(1.0/lhsl));
       // residual correction for this column with updated regression
       for (size_t obs=0; obs < F->nelem; obs++)
          fit.data[obs] += regcoeff->val[col] * colptr[F->data[obs]];
@@ -205,6 +214,16 @@ void modelRanfc1::restart() {
    varmodel->restart();
 }
 
+void modelRanfc1::saveState(FILE* f) {
+   modelCoeff::saveState(f);
+   varmodel->saveState(f);
+}
+
+void modelRanfc1::loadState(FILE* f) {
+   modelCoeff::loadState(f);
+   varmodel->loadState(f);
+}
+
 // fillFit() here defines an empty version - making fit is already done in sample()
 void modelRanfc1::fillFit() { }
 
@@ -215,7 +234,8 @@ void modelRanfc1::prepForOutput() {
    for(size_t row=0; row< K->nrow; row++) {
       par->val[row]=0.0l;
       for(size_t col=0; col<K->ncol; col++) {
-         par->val[row] += K->data[col][row] * regcoeff->val[col];
+         double evec = K->useFloat ? double(K->fdata[col][row]) : K->data[col][row];
+         par->val[row] += evec * regcoeff->val[col];
       }
    }
 };
@@ -380,7 +400,7 @@ void modelRanfck::sample() {
       }
       // add prior precision from varmodel - [ToDo] currently only diagVarStr is possible
       lhsl += ((diagVarStr*)varmodel)->weights[col];
-      regcoeff->val[col] = R::rnorm( (rhsl/lhsl), sqrt(1.0/lhsl));
+      regcoeff->val[col] = Rbayz::rng->rnorm( (rhsl/lhsl), sqrt(1.0/lhsl));
       // 3. update fit and resid with updated regression - here need to add last evec to covarint
       for(size_t i=0; i< covarint.nelem; i++) {
          fit.data[i] += regcoeff->val[col] * covarint.data[i];
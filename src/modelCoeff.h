@@ -9,6 +9,8 @@
 #include "modelResp.h"
 #include "parsedModelTerm.h"
 #include <unistd.h>
+#include <algorithm>
+#include "rbayzExceptions.h"
 
 class modelCoeff : public modelBase {
    
@@ -34,6 +36,14 @@ public:
 
    virtual void fillFit() = 0;
 
+   void saveState(FILE* f) {
+      writeStateVector(f, fit.data, fit.nelem);
+   }
+
+   void loadState(FILE* f) {
+      readStateVector(f, fit.data, fit.nelem, "fit of " + par->Name);
+   }
+
    // make statistics to estimate scale of fitted values:
    // lhs=sum(fit^2), rhs=sum(fit*resid) with resid de-corrected for fit.
    void getFitScaleStats(double & lhs, double & rhs) {
@@ -45,6 +55,37 @@ public:
       }
    }
 
+   // Draw coefficient k from its full conditional N(rhs/lhs, 1/lhs). With method VB the generator is in
+   // expectation mode and this gives the mean, the variance is stored in par->vbVar.
+   double sampleCoeff(size_t k, double rhs, double lhs) {
+      if(Rbayz::rng->expectation) par->vbVar[k] = 1.0l/lhs;
+      return Rbayz::rng->rnorm(rhs/lhs, sqrt(1.0l/lhs));
+   }
+
+   // Method VB: the effective number of parameters, sum over coefficients of 1 - priorPrec*vbVar, which
+   // is 1 for fixed effects (prior precision 0) and less for shrunken random effects. Coefficients
+   // that are not estimated (vbVar zero) do not count.
+   virtual double vbPriorPrec(size_t k) { return 0.0l; }
+   double vbEffectiveN() {
+      double n=0.0l;
+      for(size_t k=0; k < par->nelem; k++)
+         if(par->vbVar[k] > 0.0l) n += 1.0l - vbPriorPrec(k)*par->vbVar[k];
+      return n;
+   }
+
+   // precision=float (or double, the default) option for models that store matrix data,
+   // the value can be given with or without quotes.
+   bool floatPrecision(parsedModelTerm & modeldescr) {
+      optionSpec prec_opt = modeldescr.allOptions["precision"];
+      if(!prec_opt.isgiven) return false;
+      std::string prec = prec_opt.valstring;
+      prec.erase(std::remove(prec.begin(), prec.end(), '"'), prec.end());
+      prec.erase(std::remove(prec.begin(), prec.end(), '\''), prec.end());
+      if(prec=="double") return false;
+      if(prec=="float") return true;
+      throw generalRbayzError("Option precision should be \"float\" or \"double\" in " + modeldescr.shortModelTerm);
+   }
+
    modelResp* respModel;
    // The following is for convenience so that all modelCoeff objects have direct
    // pointers to residuals and residual variance, and it only needs to be set once
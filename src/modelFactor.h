@@ -17,6 +17,9 @@
 #include "modelCoeff.h"
 #include "dataFactor.h"
 #include "optionsInfo.h"
+#include "indepVarStr.h"
+#include "threadPool.h"
+#include "rbayzExceptions.h"
 //#include <unistd.h>
 
 class modelFactor : public modelCoeff {
@@ -30,6 +33,7 @@ public:
       par = new parVector(modeldescr, 0.0l, F->labels);
       lhs.resize(F->labels.size(),0);
       rhs.resize(F->labels.size(),0);
+      setup_levels(modeldescr, rmod);
    }
 
    // constructor with a variance list used by (some) random effect models; it is used to
@@ -41,9 +45,11 @@ public:
       par = new parVector(modeldescr, 0.0l, F->labels);
       lhs.resize(F->labels.size(),0);
       rhs.resize(F->labels.size(),0);
+      setup_levels(modeldescr, rmod);
    }
    
    ~modelFactor() {
+      delete pool;
       delete F;
       delete par;
    }
@@ -56,32 +62,115 @@ public:
    
 protected:
 
+   friend class jointFixedSampler;        // works on F of fx() terms to sample them jointly
+
+   // The level->observations index of F is used to collect lhs and rhs per level, reading the
+   // residuals of one level at a time and writing only lhs[k] and rhs[k]. With the homogeneous
+   // (idenVarStr) residual variance model all residPrec are the same and are not read per observation.
+   // lhs[k] is the sum of residual precisions of level k, kept in levelPrecSum: with scaled weights
+   // (IDEN, DIAG) this has the sums of the relative weights, made once and multiplied by the current
+   // scale, otherwise the sums are made again when the residual model changes its weights.
+   // threads=k option: levels are split in k parts with about equal numbers of observations, and
+   // the residual (de)corrections in k contiguous parts of the observations, run by a thread pool.
+   void setup_levels(parsedModelTerm & modeldescr, modelResp * rmod) {
+      F->buildLevelIndex();
+      homogeneousResid = (dynamic_cast<idenVarStr*>(rmod->varModel) != 0);
+      optionSpec threads_opt = modeldescr.allOptions["threads"];
+      if(threads_opt.isgiven) {
+         double k = threads_opt.valnumb[0];
+         if(k < 1 || k != std::floor(k))
+            throw generalRbayzError("Option threads should be a positive integer in " + modeldescr.shortModelTerm);
+         size_t nparts = std::min(size_t(k), F->nelem / minPartSize);
+         if(nparts > 1) {
+            pool = new threadPool(nparts);
+            levelPart.assign(nparts+1, par->nelem);
+            levelPart[0] = 0;
+            size_t part=1;
+            for(size_t lev=0; lev < par->nelem && part < nparts; lev++) {
+               if(F->levelStart[lev+1] >= F->nelem * part / nparts) levelPart[part++] = lev+1;
+            }
+         }
+      }
+   }
+
    void resid_correct() {
-      for (size_t obs=0; obs < F->nelem; obs++)
+      if(pool==0) resid_correct(0, F->nelem);
+      else pool->run([&](size_t part) {
+         resid_correct(F->nelem * part / pool->size(), F->nelem * (part+1) / pool->size());
+      });
+   }
+
+   void resid_correct(size_t first, size_t last) {
+      for (size_t obs=first; obs < last; obs++)
         resid[obs] -= par->val[F->data[obs]];
    }
 
    void resid_decorrect() {
-      for (size_t obs=0; obs < F->nelem; obs++)
+      if(pool==0) resid_decorrect(0, F->nelem);
+      else pool->run([&](size_t part) {
+         resid_decorrect(F->nelem * part / pool->size(), F->nelem * (part+1) / pool->size());
+      });
+   }
+
+   void resid_decorrect(size_t first, size_t last) {
+      for (size_t obs=first; obs < last; obs++)
         resid[obs] += par->val[F->data[obs]];
    }
 
    void collect_lhs_rhs() {
-      size_t k;
-      for(k=0; k<par->nelem; k++) {
-         rhs[k] = 0.0;
-         lhs[k] = 0.0;
-      }
-      for (size_t obs=0; obs < F->nelem; obs++) {
-         k=F->data[obs];
-         rhs[k] += residPrec[obs] * resid[obs];
-         lhs[k] += residPrec[obs];
+      indepVarStr* residVar = respModel->varModel;
+      remakePrecSum = levelPrecSum.empty() ||
+                      (!residVar->scaledWeights && residVar->weightsVersion != precSumVersion);
+      if(remakePrecSum) levelPrecSum.resize(par->nelem);
+      precScale = residVar->scaledWeights ? residVar->weightScale : 1.0l;
+      if(pool==0) collect_lhs_rhs(0, par->nelem);
+      else pool->run([&](size_t part) { collect_lhs_rhs(levelPart[part], levelPart[part+1]); });
+      precSumVersion = residVar->weightsVersion;
+   }
+
+   void collect_lhs_rhs(size_t firstLevel, size_t lastLevel) {
+      const size_t* levelObs = F->levelObs.data();
+      size_t obs, begin, end;
+      for(size_t k=firstLevel; k<lastLevel; k++) {
+         double sumr=0.0l, sumw=0.0l;
+         begin = F->levelStart[k];
+         end = F->levelStart[k+1];
+         if(homogeneousResid) {
+            for(size_t j=begin; j < end; j++) sumr += resid[levelObs[j]];
+            rhs[k] = precScale * sumr;
+            if(remakePrecSum) levelPrecSum[k] = double(end - begin);
+         }
+         else if(remakePrecSum) {
+            for(size_t j=begin; j < end; j++) {
+               obs = levelObs[j];
+               sumr += residPrec[obs] * resid[obs];
+               sumw += residPrec[obs];
+            }
+            rhs[k] = sumr;
+            levelPrecSum[k] = sumw / precScale;
+         }
+         else {
+            for(size_t j=begin; j < end; j++) {
+               obs = levelObs[j];
+               sumr += residPrec[obs] * resid[obs];
+            }
+            rhs[k] = sumr;
+         }
+         lhs[k] = precScale * levelPrecSum[k];
       }
    }
 
    dataFactor *F;
    std::vector<double> lhs, rhs;          // working vectors to collect LHS an RHS of equations
                                           // maybe faster using the simpleVector class?
+   bool homogeneousResid=false;
+   std::vector<double> levelPrecSum;      // sums of (relative) residual precisions per level
+   double precScale=1.0l;
+   unsigned long precSumVersion=0;
+   bool remakePrecSum=true;
+   threadPool* pool=0;                    // threads=k option
+   std::vector<size_t> levelPart;         // first level of every part, and par->nelem at the end
+   static const size_t minPartSize=4096;
 
 };
 
@@ -31,7 +31,7 @@ public:
       collect_lhs_rhs();
       for(size_t k=1; k<par->nelem; k++) {  // in fixf par[0] remains zero!, this runs from k=1
          if (lhs[k]>0)                     // if lhs is zero estimate will be set to 0
-            par->val[k] = R::rnorm( (rhs[k]/lhs[k]), sqrt(1.0/lhs[k]));
+            par->val[k] = sampleCoeff(k, rhs[k], lhs[k]);
          else
             par->val[k]=0.0;
       }
@@ -42,6 +42,8 @@ public:
 
    void restart() {}
 
+   bool vbAvailable() { return true; }
+
 };
 
 #endif /* modelFixf_h */
@@ -18,6 +18,7 @@
 #include "modelCoeff.h"
 #include "dataCovar.h"
 #include "parsedModelTerm.h"
+#include "columnKernels.h"
 
 class modelFreg : public modelCoeff {
    
@@ -38,38 +39,37 @@ public:
       delete par;
    }
    
+   // Fused update as in modelMatrix::update_column(): the de-correction for the old beta is added
+   // to rhs analytically, and only the change in beta is applied to the residuals.
    void sample() {
-      resid_decorrect();
+      double beta_old = par->val[0];
       collect_lhs_rhs();
-      par->val[0] = R::rnorm( (rhs/lhs), sqrt(1.0/lhs));
-      resid_correct();
+      rhs += beta_old * lhs;
+      par->val[0] = sampleCoeff(0, rhs, lhs);
+      columnAxpy(C->data, 0, 0.0l, par->val[0] - beta_old, resid, C->nelem);
    }
 
    void sampleHpars() {}
 
    void restart() {}
 
+   bool vbAvailable() { return true; }
+
    void fillFit() {
       for (size_t obs=0; obs < C->nelem; obs++)
         fit[obs] = par->val[0] * C->data[obs];
    }
 
    void resid_correct() {
-      for (size_t obs=0; obs < C->nelem; obs++)
-        resid[obs] -= par->val[0] * C->data[obs];
+      columnAxpy(C->data, 0, 0.0l, par->val[0], resid, C->nelem);
    }
 
    void resid_decorrect() {
-      for (size_t obs=0; obs < C->nelem; obs++)
-        resid[obs] += par->val[0] * C->data[obs];
+      columnAxpy(C->data, 0, 0.0l, -par->val[0], resid, C->nelem);
    }
 
    void collect_lhs_rhs() {
-      lhs = 0.0; rhs=0.0;
-      for (size_t obs=0; obs < C->nelem; obs++) {
-         rhs += residPrec[obs] * resid[obs] * C->data[obs];
-         lhs += C->data[obs] * residPrec[obs] * C->data[obs];
-      }
+      columnDot(C->data, 0, 0.0l, resid, residPrec, C->nelem, rhs, lhs, true);
    }
 
    dataCovar *C;
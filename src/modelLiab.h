@@ -17,6 +17,7 @@
 #include <string>
 #include <utility>
 #include "modelResp.h"
+#include "Rbayz.h"
 
 class modelLiab : public modelResp {
    
@@ -41,7 +42,7 @@ public:
       for (size_t obs=0; obs<resid.size(); obs++) {
          bounds = liabBounds(catData[obs]);  // obtain liability boundaries for this obs, this
                                              // also depends on current liab or residual?
-         Ydata[obs] = R::runif(bounds.first,bounds.second);
+         Ydata[obs] = Rbayz::rng->runif(bounds.first,bounds.second);
          resid[obs] = Ydata[obs];
       }
    }
@@ -21,29 +21,126 @@
 #include "modelCoeff.h"
 #include "nameTools.h"
 #include "indexTools.h"
+#include "columnKernels.h"
+#include "blockKernels.h"
+#include "threadPool.h"
 
 class modelMatrix : public modelCoeff {
    
 public:
    
    modelMatrix(parsedModelTerm & modeldescr, modelResp * rmod)
-         : modelCoeff(modeldescr, rmod)
+         : modelCoeff(modeldescr, rmod), colSumSq(), rowPrec(), rowResid(), rowResidStart(), xpxRow()
    {
       // For now only allowing a matrix input where there is an index variable (model
       // made with id/matrix). It could be extended to allow for no id, so that matrix needs to
       // be aliged 1:1 with data records, then the 'id' is bascially a 1:1 link.
       bool acceptable0VarType = modeldescr.variableTypes[0]==1 || modeldescr.variableTypes[0]==2 ||
                               modeldescr.variableTypes[0]==4 || modeldescr.variableTypes[0]==5;
-      if( ! (acceptable0VarType && modeldescr.variableTypes[1]==6) )
+      if( ! (acceptable0VarType && (modeldescr.variableTypes[1]==6 || modeldescr.variableTypes[1]==10)) )
          throw generalRbayzError("variable types in rr() model are not (convertable to) <factor>/<matrix>");
       F = new dataFactor(modeldescr.variableObjects[0], modeldescr.variableNames[0]);
       M = new dataMatrix(modeldescr.variableObjects[1], modeldescr.variableNames[1]);
+      if(floatPrecision(modeldescr) && !M->packed && !M->sparse) M->storeAsFloat();
       par = new parVector(modeldescr, 0.0l, M->colnames);
 //      weights.initWith(M->ncol,1.0l);  // I think weights is not used (but using varmodel->weights)
       builObsIndex(obsIndex,F,M);
+      // With the homogeneous (idenVarStr) residual variance model all residPrec are the same, and lhs
+      // is the column sum of squares times the current residual precision: the sums of squares are
+      // computed once here (over observations, so including the obsIndex gather).
+      homogeneousResid = (dynamic_cast<idenVarStr*>(rmod->varModel) != 0);
+      if(homogeneousResid && M->sparse) {        // sparse: from the non-zeros and the counts per row
+         std::vector<double> rowCount(M->nrow, 0.0l);
+         for(size_t obs=0; obs < F->nelem; obs++) rowCount[obsIndex[obs]] += 1.0l;
+         colSumSq.initWith(M->ncol, 0.0l);
+         for(size_t col=0; col < M->ncol; col++) {
+            double c = M->colCenter[col], x, sum = c * c * double(F->nelem);
+            for(int k=M->sparseStart[col]; k < M->sparseStart[col+1]; k++) {
+               x = M->sparseVal[k];
+               sum += rowCount[M->sparseRow[k]] * (x*x - 2.0l*c*x);
+            }
+            colSumSq[col] = sum;
+         }
+      }
+      else if(homogeneousResid) {
+         colSumSq.initWith(M->ncol, 0.0l);
+         for(size_t col=0; col < M->ncol; col++) {
+            if(M->useFloat) colSumSq[col] = columnSumSq(M->fdata[col], col);
+            else if(M->packed) colSumSq[col] = columnSumSq(M->packedCol(col), col);
+            else colSumSq[col] = columnSumSq(M->column(col), col);
+         }
+      }
+      // Aggregated mode when there are on average 2 or more observations per matrix row, a sparse
+      // matrix always uses the aggregated mode.
+      aggregated = (F->nelem >= 2 * M->nrow) || M->sparse;
+      if(aggregated) {
+         rowPrec.initWith(M->nrow, 0.0l);
+         rowResid.initWith(M->nrow, 0.0l);
+         rowResidStart.initWith(M->nrow, 0.0l);
+      }
+      // block=b option for joint updates of b adjacent columns, not used for sparse matrices
+      // where the blocks would be dense.
+      optionSpec block_opt = modeldescr.allOptions["block"];
+      if(block_opt.isgiven) {
+         double b = block_opt.valnumb[0];
+         if(b < 1 || b != std::floor(b))
+            throw generalRbayzError("Option block should be a positive integer in " + modeldescr.shortModelTerm);
+         blockSize = size_t(b);
+         if(M->sparse && blockSize > 1) {
+            Rbayz::Messages.push_back("Warning: block option is not used with a sparse matrix in " + modeldescr.shortModelTerm);
+            blockSize = 1;
+         }
+         if(blockSize > M->ncol) blockSize = M->ncol;
+      }
+      // The grid-LASSO (V=LASS) has its own sample() with single-site Metropolis-Hastings updates
+      // that do not use the block and xpx modes, so these options are not set up for it.
+      bool lassoModel = (modeldescr.varianceStruct=="LASS");
+      if(lassoModel && blockSize > 1) {
+         Rbayz::Messages.push_back("Warning: block option is not used with V=LASS in " + modeldescr.shortModelTerm);
+         blockSize = 1;
+      }
+      // threads=k option: the loops over observations (or matrix rows in aggregated mode) for one
+      // column are split in k parts run by a thread pool, the partial lhs and rhs are added in the
+      // order of the parts.
+      // xpx option: sweeps run on the precomputed X'X (see begin_xpx), this needs the homogeneous
+      // residual variance so that X'WX does not change.
+      optionSpec xpx_opt = modeldescr.allOptions["xpx"];
+      if(xpx_opt.isgiven && xpx_opt.valbool) {
+         if(lassoModel)
+            Rbayz::Messages.push_back("Warning: xpx option is not used with V=LASS in " + modeldescr.shortModelTerm);
+         else if(!homogeneousResid || M->sparse)
+            Rbayz::Messages.push_back("Warning: xpx option needs a homogeneous residual variance and a dense matrix, not used in "
+                                      + modeldescr.shortModelTerm);
+         else if(double(M->ncol)*double(M->ncol)*8.0 > 4e9)
+            Rbayz::Messages.push_back("Warning: X'X would need more than 4GB, xpx option not used in "
+                                      + modeldescr.shortModelTerm);
+         else {
+            useXpx = true;
+            if(blockSize > 1) {
+               Rbayz::Messages.push_back("Warning: block option is not used with xpx in " + modeldescr.shortModelTerm);
+               blockSize = 1;
+            }
+            setup_xpx();
+         }
+      }
+      if(blockSize > 1) setup_block();
+      optionSpec threads_opt = modeldescr.allOptions["threads"];
+      if(threads_opt.isgiven) {
+         double k = threads_opt.valnumb[0];
+         if(k < 1 || k != std::floor(k))
+            throw generalRbayzError("Option threads should be a positive integer in " + modeldescr.shortModelTerm);
+         size_t nloop = (aggregated || useXpx) ? M->nrow : F->nelem;
+         size_t nparts = std::min(size_t(k), nloop / minPartSize);
+         if(nparts > 1 && !M->sparse) {
+            pool = new threadPool(nparts);
+            partXr.resize(nparts);
+            partXx.resize(nparts);
+         }
+      }
    }
    
    ~modelMatrix() {
+      delete pool;
       delete M;
       delete F;
       delete par;
@@ -51,30 +148,363 @@ public:
    
    // methods for single-site updates: data (de)corrections for a single covariate
    // column, and LHS and RHS statistics for a single covariate column.
+   // The covariates are centered on the fly by subtracting M->colCenter (see dataMatrix.h), packed
+   // genotype columns are decoded in the loops (matDot and matAxpy).
    // Updated to skip (de)corrections when regression coeff is zero - this could have big
    // impact using the code for mixture models with many zero regcoeff.
+   // The loops over observations are in columnKernels (vectorized for double storage).
    void resid_correct(size_t col) {
       if(par->val[col]==0.0l) return;
-      double * colptr = M->data[col];
-      for (size_t obs=0; obs < F->nelem; obs++) {
-         resid[obs] -= par->val[col] * colptr[obsIndex[obs]];
-      }
+      column_axpy(col, par->val[col]);
    }
 
    void resid_decorrect(size_t col) {
       if(par->val[col]==0.0l) return;
-      double * colptr = M->data[col];
-      for (size_t obs=0; obs < F->nelem; obs++)
-         resid[obs] += par->val[col] * colptr[obsIndex[obs]];
+      column_axpy(col, -par->val[col]);
+   }
+
+   // Fused single-site update of column col with prior precision priorPrec: the rhs with the residuals
+   // de-corrected for the old beta is computed analytically as x'W(resid + beta_old x) = x'W resid +
+   // beta_old x'Wx, so one pass over the observations collects the statistics, and one pass applies
+   // the change in beta to the residuals (instead of decorrect, collect and correct passes).
+   void update_column(size_t col, double priorPrec) {
+      double beta_old = par->val[col];
+      double xwr, xwx;
+      collect_lhs_rhs(xwx, xwr, col);
+      double lhs = xwx + priorPrec;
+      double rhs = xwr + beta_old * xwx;
+      par->val[col] = sampleCoeff(col, rhs, lhs);
+      column_axpy(col, par->val[col] - beta_old);
+   }
+
+   // Joint update of nb adjacent columns from start, with prior precisions priorPrec[0..nb-1], from
+   // their conditional multivariate normal. The centered covariates for the block are copied in X
+   // (and scaled by sqrt of the weights in Z), then lhs = X'WX is a BLAS crossproduct and, as in
+   // update_column(), the rhs for residuals de-corrected for the old betas is X'W resid + X'WX beta_old.
+   // The new betas are mean + L^-T z with L the Cholesky factor of lhs + prior precisions, and the
+   // residuals get one product with the change in betas. Works over the matrix rows in aggregated
+   // mode, otherwise over the observations.
+   // The block buffers are sized once for the largest block (blockSize), blockX and blockZ have
+   // column j of a block at j*n for the n used in the sweep (matrix rows or observations).
+   void setup_block() {
+      size_t n = aggregated ? M->nrow : F->nelem;
+      blockX.resize(n*blockSize);
+      blockZ.resize(n*blockSize);
+      blockSqrtW.resize(n);
+      blockZr.resize(n);
+      blockC.resize(blockSize*blockSize);
+      blockRhs.resize(blockSize);
+      blockBeta.resize(blockSize);
+      blockNormal.resize(blockSize);
+   }
+
+   void update_block(size_t start, size_t nb, const double* priorPrec) {
+      size_t n = aggregatedActive ? M->nrow : F->nelem;
+      const double* w = aggregatedActive ? rowPrec.data : residPrec;
+      double* r = aggregatedActive ? rowResid.data : resid;
+      for(size_t i=0; i < n; i++) {
+         blockSqrtW[i] = std::sqrt(w[i]);
+         blockZr[i] = blockSqrtW[i] * r[i];
+      }
+      for(size_t j=0; j < nb; j++) {
+         if(M->useFloat) fillBlockColumn(M->fdata[start+j], start+j, j, n);
+         else if(M->packed) fillBlockColumn(M->packedCol(start+j), start+j, j, n);
+         else fillBlockColumn(M->column(start+j), start+j, j, n);
+      }
+      blockCrossprod(blockZ.data(), int(n), int(nb), blockZr.data(), blockC.data(), blockRhs.data());
+      double cb;
+      for(size_t j=0; j < nb; j++) {
+         blockBeta[j] = par->val[start+j];
+         cb = 0.0l;
+         for(size_t k=0; k < nb; k++)      // lhs*beta_old using the lower triangle of C
+            cb += ((k >= j) ? blockC[j*nb+k] : blockC[k*nb+j]) * par->val[start+k];
+         blockRhs[j] += cb;
+      }
+      for(size_t j=0; j < nb; j++) blockC[j*nb+j] += priorPrec[j];
+      if(!blockCholSolve(blockC.data(), int(nb), blockRhs.data()))
+         throw generalRbayzError("Cholesky decomposition failed in block update of " + par->Name);
+      for(size_t j=0; j < nb; j++) blockNormal[j] = Rbayz::rng->rnorm(0.0l, 1.0l);
+      blockCholBackSolve(blockC.data(), int(nb), blockNormal.data());
+      for(size_t j=0; j < nb; j++) {
+         par->val[start+j] = blockRhs[j] + blockNormal[j];
+         blockBeta[j] = par->val[start+j] - blockBeta[j];     // now the change in beta
+      }
+      blockAxpy(blockX.data(), int(n), int(nb), blockBeta.data(), r);
+   }
+
+   template<typename C> void fillBlockColumn(C colptr, size_t col, size_t j, size_t n) {
+      double center = M->colCenter[col], x;
+      double* X = &blockX[j*n];
+      double* Z = &blockZ[j*n];
+      for(size_t i=0; i < n; i++) {
+         x = (aggregatedActive ? colptr[i] : colptr[obsIndex[i]]) - center;
+         X[i] = x;
+         Z[i] = x * blockSqrtW[i];
+      }
+   }
+
+   // set a regression to zero (e.g. for zero variance) and update residuals
+   void zero_column(size_t col) {
+      if(par->val[col]==0.0l) return;
+      column_axpy(col, -par->val[col]);
+      par->val[col] = 0.0l;
+   }
+
+   // A sweep over the columns starts with begin_sweep() and ends with end_sweep(), this selects the
+   // xpx or aggregated modes when they are used.
+   void begin_sweep() {
+      if(useXpx) begin_xpx();
+      else if(aggregated) begin_aggregated();
+   }
+
+   void end_sweep() {
+      if(useXpx) end_xpx();
+      else if(aggregated) end_aggregated();
+   }
+
+   // xpx mode: X'X over the observations (centered covariates, each matrix row counted for its number
+   // of observations) is computed once in setup_xpx(). A sweep starts with q = X'resid, computed from
+   // the residual sums per matrix row, then the column updates only use X'X and q: lhs and rhs are
+   // X'X[k,k] and q[k] times the residual precision, and a change in beta_k updates q by the column k
+   // of X'X (O(ncol) per update). The residuals are updated once at the end of the sweep with the
+   // changes in beta. Per sweep this costs O(nobs + nrow*ncol + ncol^2) instead of O(nobs*ncol).
+   void setup_xpx() {
+      size_t nc = M->ncol;
+      std::vector<double> rowCount(M->nrow, 0.0l);
+      for(size_t obs=0; obs < F->nelem; obs++) rowCount[obsIndex[obs]] += 1.0l;
+      for(size_t row=0; row < M->nrow; row++) rowCount[row] = std::sqrt(rowCount[row]);
+      XtX.assign(nc*nc, 0.0l);
+      // the crossproduct is made in chunks of rows of at most 256MB
+      size_t chunkRows = std::max(size_t(1), size_t(33554432) / nc);
+      std::vector<double> Z;
+      for(size_t lo=0; lo < M->nrow; lo += chunkRows) {
+         size_t m = std::min(chunkRows, M->nrow - lo);
+         Z.resize(m*nc);
+         for(size_t k=0; k < nc; k++) {
+            if(M->useFloat) fillXpxChunk(M->fdata[k], k, lo, m, rowCount, &Z[k*m]);
+            else if(M->packed) fillXpxChunk(M->packedCol(k), k, lo, m, rowCount, &Z[k*m]);
+            else fillXpxChunk(M->column(k), k, lo, m, rowCount, &Z[k*m]);
+         }
+         blockCrossprodAdd(Z.data(), int(m), int(nc), XtX.data());
+      }
+      for(size_t k=0; k < nc; k++)            // copy lower to upper triangle
+         for(size_t j=k+1; j < nc; j++) XtX[j*nc+k] = XtX[k*nc+j];
+      xpxQ.resize(nc);
+      xpxBetaStart.resize(nc);
+      xpxRow.initWith(M->nrow, 0.0l);
+   }
+
+   template<typename C> void fillXpxChunk(C colptr, size_t k, size_t lo, size_t m,
+                                          std::vector<double> & sqrtCount, double* Z) {
+      double center = M->colCenter[k];
+      for(size_t i=0; i < m; i++) Z[i] = sqrtCount[lo+i] * (colptr[lo+i] - center);
+   }
+
+   void begin_xpx() {
+      for(size_t row=0; row < M->nrow; row++) xpxRow[row] = 0.0l;
+      for(size_t obs=0; obs < F->nelem; obs++) xpxRow[obsIndex[obs]] += resid[obs];
+      double dummy;
+      for(size_t k=0; k < M->ncol; k++) {
+         matDot(k, 0, xpxRow.data, 0, M->nrow, xpxQ[k], dummy, false);
+         xpxBetaStart[k] = par->val[k];
+      }
+      xpxActive = true;
+   }
+
+   void end_xpx() {
+      xpxActive = false;
+      for(size_t row=0; row < M->nrow; row++) xpxRow[row] = 0.0l;
+      double delta;
+      for(size_t k=0; k < M->ncol; k++) {       // xpxRow gets the change in fit, as -(-delta)*x
+         delta = par->val[k] - xpxBetaStart[k];
+         if(delta==0.0l) continue;
+         matAxpy(k, 0, -delta, xpxRow.data, M->nrow);
+      }
+      for(size_t obs=0; obs < F->nelem; obs++) resid[obs] -= xpxRow[obsIndex[obs]];
+   }
+
+   // Aggregated mode: in a sweep over the columns (between begin_aggregated and end_aggregated) the
+   // residuals are kept per matrix row, as precision-weighted mean residual with the sum of precisions
+   // per row, so that the column updates run over the matrix rows with contiguous access instead of
+   // over all observations. The residuals are updated once at the end of the sweep.
+   void begin_aggregated() {
+      for(size_t row=0; row < M->nrow; row++) {
+         rowPrec[row] = 0.0l;
+         rowResid[row] = 0.0l;
+      }
+      size_t row;
+      for(size_t obs=0; obs < F->nelem; obs++) {
+         row = obsIndex[obs];
+         rowPrec[row] += residPrec[obs];
+         rowResid[row] += residPrec[obs] * resid[obs];
+      }
+      sparseResidSum = 0.0l;
+      totalPrec = 0.0l;
+      for(row=0; row < M->nrow; row++) {
+         if(rowPrec[row] > 0.0l) rowResid[row] /= rowPrec[row];
+         rowResidStart[row] = rowResid[row];
+         sparseResidSum += rowPrec[row] * rowResid[row];
+         totalPrec += rowPrec[row];
+      }
+      sparseOffset = 0.0l;
+      aggregatedActive = true;
+   }
+
+   void end_aggregated() {
+      size_t row;
+      for(size_t obs=0; obs < F->nelem; obs++) {
+         row = obsIndex[obs];
+         resid[obs] -= rowResidStart[row] - (rowResid[row] + sparseOffset);
+      }
+      aggregatedActive = false;
+   }
+
+   // Sparse matrices in the aggregated mode: the centering (x - c) would make every update dense, so
+   // only the non-zeros update rowResid and the -c part is kept in sparseOffset, which applies to all
+   // rows (row mean residual = rowResid + sparseOffset). With the sum of precision-weighted rowResid
+   // (sparseResidSum) and the total precision, rhs and lhs follow from sums over the non-zeros:
+   //   rhs = sum W x m + g sum W x - c (sparseResidSum + g totalPrec), lhs = sum W x^2 - 2c sum W x + c^2 totalPrec
+   // where m is rowResid and g is sparseOffset.
+   void sparse_lhs_rhs(double & lhs, double & rhs, size_t col) {
+      double sumWxm=0.0l, sumWx=0.0l, sumWxx=0.0l, wx;
+      int row;
+      for(int k=M->sparseStart[col]; k < M->sparseStart[col+1]; k++) {
+         row = M->sparseRow[k];
+         wx = rowPrec[row] * M->sparseVal[k];
+         sumWxm += wx * rowResid[row];
+         sumWx += wx;
+         sumWxx += wx * M->sparseVal[k];
+      }
+      double c = M->colCenter[col];
+      rhs = sumWxm + sparseOffset * sumWx - c * (sparseResidSum + sparseOffset * totalPrec);
+      lhs = sumWxx - 2.0l * c * sumWx + c * c * totalPrec;
+   }
+
+   void sparse_axpy(size_t col, double delta) {
+      double sumWx=0.0l;
+      int row;
+      for(int k=M->sparseStart[col]; k < M->sparseStart[col+1]; k++) {
+         row = M->sparseRow[k];
+         rowResid[row] -= delta * M->sparseVal[k];
+         sumWx += rowPrec[row] * M->sparseVal[k];
+      }
+      sparseResidSum -= delta * sumWx;
+      sparseOffset += delta * M->colCenter[col];
+   }
+
+   // resid -= delta * x for column col
+   void column_axpy(size_t col, double delta) {
+      if(delta==0.0l) return;
+      if(xpxActive) {
+         const double* xtxcol = &XtX[col*M->ncol];
+         for(size_t k=0; k < M->ncol; k++) xpxQ[k] -= delta * xtxcol[k];
+         return;
+      }
+      if(aggregatedActive && M->sparse) {
+         sparse_axpy(col, delta);
+         return;
+      }
+      if(aggregatedActive) matAxpy(col, 0, delta, rowResid.data, M->nrow);
+      else matAxpy(col, obsIndex.data(), delta, resid, F->nelem);
+   }
+
+   // columnDot and columnAxpy (or the packed versions) on column col of M for any storage of M.
+   void matDot(size_t col, const size_t* index, const double* r, const double* w, size_t n,
+               double & xr, double & xx, bool needXX) {
+      if(M->useFloat) partDot(M->fdata[col], index, M->colCenter[col], r, w, n, xr, xx, needXX);
+      else if(M->packed) partDot(M->packedCol(col), index, M->colCenter[col], r, w, n, xr, xx, needXX);
+      else partDot(M->column(col), index, M->colCenter[col], r, w, n, xr, xx, needXX);
+   }
+
+   void matAxpy(size_t col, const size_t* index, double a, double* r, size_t n) {
+      if(M->useFloat) partAxpy(M->fdata[col], index, M->colCenter[col], a, r, n);
+      else if(M->packed) partAxpy(M->packedCol(col), index, M->colCenter[col], a, r, n);
+      else partAxpy(M->column(col), index, M->colCenter[col], a, r, n);
+   }
+
+   // columnDot and columnAxpy, split over the thread pool when there is one; every part takes a
+   // contiguous slice of the observations (or rows), so each thread updates its own residuals.
+   template<typename T> void partDot(const T* col, const size_t* index, double center, const double* r,
+                                     const double* w, size_t n, double & xr, double & xx, bool needXX) {
+      if(pool==0) {
+         columnDot(col, index, center, r, w, n, xr, xx, needXX);
+         return;
+      }
+      size_t nparts = pool->size();
+      pool->run([&](size_t part) {
+         size_t lo = n * part / nparts, hi = n * (part+1) / nparts;
+         columnDot((index==0) ? col+lo : col, (index==0) ? 0 : index+lo, center, r+lo, (w==0) ? 0 : w+lo,
+                   hi-lo, partXr[part], partXx[part], needXX);
+      });
+      xr = 0.0l;
+      xx = 0.0l;
+      for(size_t part=0; part < nparts; part++) {
+         xr += partXr[part];
+         xx += partXx[part];
+      }
+   }
+
+   template<typename T> void partAxpy(const T* col, const size_t* index, double center, double a,
+                                      double* r, size_t n) {
+      if(pool==0) {
+         columnAxpy(col, index, center, a, r, n);
+         return;
+      }
+      size_t nparts = pool->size();
+      pool->run([&](size_t part) {
+         size_t lo = n * part / nparts, hi = n * (part+1) / nparts;
+         columnAxpy((index==0) ? col+lo : col, (index==0) ? 0 : index+lo, center, a, r+lo, hi-lo);
+      });
+   }
+
+   // The packed versions: a part over consecutive rows starts at row lo of the column.
+   void partDot(packedColumn col, const size_t* index, double center, const double* r,
+                const double* w, size_t n, double & xr, double & xx, bool needXX) {
+      if(pool==0) {
+         packedDot(col, 0, index, center, r, w, n, xr, xx, needXX);
+         return;
+      }
+      size_t nparts = pool->size();
+      pool->run([&](size_t part) {
+         size_t lo = n * part / nparts, hi = n * (part+1) / nparts;
+         packedDot(col, (index==0) ? lo : 0, (index==0) ? 0 : index+lo, center, r+lo, (w==0) ? 0 : w+lo,
+                   hi-lo, partXr[part], partXx[part], needXX);
+      });
+      xr = 0.0l;
+      xx = 0.0l;
+      for(size_t part=0; part < nparts; part++) {
+         xr += partXr[part];
+         xx += partXx[part];
+      }
+   }
+
+   void partAxpy(packedColumn col, const size_t* index, double center, double a, double* r, size_t n) {
+      if(pool==0) {
+         packedAxpy(col, 0, index, center, a, r, n);
+         return;
+      }
+      size_t nparts = pool->size();
+      pool->run([&](size_t part) {
+         size_t lo = n * part / nparts, hi = n * (part+1) / nparts;
+         packedAxpy(col, (index==0) ? lo : 0, (index==0) ? 0 : index+lo, center, a, r+lo, hi-lo);
+      });
    }
 
    // de+correct residuals and fit for a 'beta update': a change in beta.
    // The difference old-beta minus new-beta is passed as 'beta_diff'.
    void resid_fit_betaUpdate(double beta_diff, size_t col) {
-      double * colptr = M->data[col];
+      if(M->useFloat) resid_fit_betaUpdate(beta_diff, M->fdata[col], col);
+      else if(M->packed) resid_fit_betaUpdate(beta_diff, M->packedCol(col), col);
+      else resid_fit_betaUpdate(beta_diff, M->column(col), col);
+   }
+
+   template<typename C> void resid_fit_betaUpdate(double beta_diff, C colptr, size_t col) {
+      double center = M->colCenter[col];
+      double x;
       for (size_t obs=0; obs < F->nelem; obs++) {
-         resid[obs] += beta_diff * colptr[obsIndex[obs]];
-         fit[obs] -= beta_diff * colptr[obsIndex[obs]];
+         x = colptr[obsIndex[obs]] - center;
+         resid[obs] += beta_diff * x;
+         fit[obs] -= beta_diff * x;
       }
    }
 
@@ -89,20 +519,38 @@ public:
       }
    }
 
-   // [ToDo] I thought there could be some efficiency gain making a method that combined resis_decorrect()
-   // and collect_lhs_rhs() because it is the same loops and some computations are re-used, but it looks more
-   // difficult to take advantage of skipping zero regcoeff (which also partly happens in sample()) ....
+   // lhs = x'Wx and rhs = x'W resid for column col (residuals not de-corrected); with homogeneous
+   // residual weights lhs comes from the cached sum of squares and the loop only collects rhs.
    void collect_lhs_rhs(double & lhs, double & rhs, size_t col) {
-      size_t matrixrow;
-      lhs = 0.0l; rhs = 0.0l;
-      double * colptr = M->data[col];
-      double temp1;
+      if(xpxActive) {
+         lhs = XtX[col*M->ncol+col] * residPrec[0];
+         rhs = xpxQ[col] * residPrec[0];
+         return;
+      }
+      if(aggregatedActive && M->sparse) {
+         sparse_lhs_rhs(lhs, rhs, col);
+         return;
+      }
+      if(aggregatedActive) {
+         matDot(col, 0, rowResid.data, rowPrec.data, M->nrow, rhs, lhs, !homogeneousResid);
+         if(homogeneousResid) lhs = colSumSq[col] * residPrec[0];
+         return;
+      }
+      const double* weights = homogeneousResid ? 0 : residPrec;
+      matDot(col, obsIndex.data(), resid, weights, F->nelem, rhs, lhs, !homogeneousResid);
+      if(homogeneousResid) {
+         rhs *= residPrec[0];
+         lhs = colSumSq[col] * residPrec[0];
+      }
+   }
+
+   template<typename C> double columnSumSq(C colptr, size_t col) {
+      double center = M->colCenter[col], x, sum=0.0l;
       for (size_t obs=0; obs < F->nelem; obs++) {
-         matrixrow = obsIndex[obs];
-         temp1 = colptr[matrixrow] * residPrec[obs];
-         rhs += temp1 * resid[obs];
-         lhs += temp1 * colptr[matrixrow];
+         x = colptr[obsIndex[obs]] - center;
+         sum += x*x;
       }
+      return sum;
    }
    
    void collect_sse(double & sse) {
@@ -114,15 +562,19 @@ public:
    // [ToDo] OBS: this fillFit is not right if the variance of random effect
    // is modelled with a scale. In that case fit = scale * par[] * covar[]
    void fillFit() {
-      double * colptr;
       for (size_t obs=0; obs < F->nelem; obs++) fit[obs] = 0.0l;
       for(size_t k=0; k < M->ncol; k++) {
-         colptr = M->data[k];
-         for (size_t obs=0; obs < F->nelem; obs++)
-            fit[obs] += par->val[k] * colptr[obsIndex[obs]];
+         if(M->useFloat) addColumnFit(M->fdata[k], k);
+         else if(M->packed) addColumnFit(M->packedCol(k), k);
+         else addColumnFit(M->column(k), k);
       }
    }
 
+   template<typename C> void addColumnFit(C colptr, size_t k) {
+      for (size_t obs=0; obs < F->nelem; obs++)
+         fit[obs] += par->val[k] * (colptr[obsIndex[obs]] - M->colCenter[k]);
+   }
+
    // Here no sample() yet, modelMatrix remains virtual. The derived classes implement sample()
    // by combining update_regressions() with update of hyper-paramters for that derived class.
 
@@ -130,6 +582,19 @@ public:
    dataFactor *F;
    double lhs, rhs;          // lhs, rhs will be scalar here (per iteration)
    std::vector<size_t> obsIndex;
+   bool homogeneousResid=false;
+   simpleDblVector colSumSq;  // per column sum of squares, only with homogeneousResid
+   bool aggregated=false, aggregatedActive=false;
+   simpleDblVector rowPrec, rowResid, rowResidStart;   // per matrix row, only in aggregated mode
+   double sparseOffset=0.0l, sparseResidSum=0.0l, totalPrec=0.0l;
+   size_t blockSize=1;        // block=b option
+   std::vector<double> blockX, blockZ, blockSqrtW, blockZr, blockC, blockRhs, blockBeta, blockNormal;
+   bool useXpx=false, xpxActive=false;     // xpx option
+   std::vector<double> XtX, xpxQ, xpxBetaStart;
+   simpleDblVector xpxRow;
+   threadPool* pool=0;       // threads=k option
+   std::vector<double> partXr, partXx;
+   static const size_t minPartSize=4096;
 
 };
 
@@ -42,7 +42,7 @@ public:
          sum += resid[obs]*residPrec[obs];
          temp += residPrec[obs];
       }
-      par->val[0] = R::rnorm((sum/temp), sqrt(1.0/temp));
+      par->val[0] = sampleCoeff(0, sum, temp);
       for (obs=0; obs < Nresid; obs++) resid[obs] -= par->val[0];
    }
 
@@ -55,6 +55,8 @@ public:
 
    void restart() {}
 
+   bool vbAvailable() { return true; }
+
 private:
 };
 
@@ -1,6 +1,9 @@
 //
 //  Rbayz --- modelMixt.h
-//  Object to modify mixture class indicator for MIXT variance structure.
+//  Object to output the mixture class indicators for MIXT variance structure: the parameter vector
+//  ppi.<name> is 1 when a coefficient is in a class with non-zero variance and 0 otherwise, so that its
+//  posterior mean is the posterior probability of inclusion. The indicators themselves are sampled in
+//  modelRregMixt and stored in its mixtVarStr.
 //
 //  Created by Luc Janss on 03/08/2018.
 //
@@ -10,30 +13,39 @@
 
 #include <Rcpp.h>
 #include "modelBase.h"
+#include "modelRreg.h"
 
 class modelMixt : public modelBase {
 
 public:
 
-   modelMixt(parsedModelTerm & modeldescr, modelRreg * rrmod)
-         : modelBase()
+   modelMixt(parsedModelTerm & modeldescr, modelRregMixt * rrmod)
+         : modelBase(), mixtvar(rrmod->mixtvar)
    {
-
+      par = new parVector(modeldescr, 0.0l, *(rrmod->par), "ppi");
+      fillIndicators();
    }
 
    ~modelMixt() {
+      delete par;
    }
    
    void sample() {
-      // update_regressions();
-      // update hyper-par (variance) using SSQ of random effects
+      fillIndicators();
    }
 
-   void sampleHpars() {
+   void sampleHpars() { }
+
+   void restart() {
+      fillIndicators();
+   }
 
+   void fillIndicators() {
+      for(size_t k=0; k < par->nelem; k++)
+         par->val[k] = (mixtvar->Vars[mixtvar->indicator[k]] > 0.0l) ? 1.0l : 0.0l;
    }
 
-   void restart() {}
+   mixtVarStr* mixtvar;
 
 };
 
@@ -30,6 +30,9 @@ public:
    void restart();
    void fillFit();
    void prepForOutput();
+   void saveState(FILE* f);
+   void loadState(FILE* f);
+   template<typename T> void sampleRegressions(T** columns);
    kernelMatrix* K;
    parVector *regcoeff;
    std::vector<size_t> obsIndex;
@@ -34,7 +34,7 @@ public:
       collect_lhs_rhs();
       for(size_t k=0; k<par->nelem; k++) {
          lhs[k] += varmodel->weights[k];
-         par->val[k] = R::rnorm((rhs[k]/lhs[k]), sqrt(1.0/lhs[k]));
+         par->val[k] = sampleCoeff(k, rhs[k], lhs[k]);
       }
       resid_correct();
    }
@@ -47,6 +47,19 @@ public:
       varmodel->restart();
    }
 
+   bool vbAvailable() { return true; }
+   double vbPriorPrec(size_t k) { return varmodel->weights[k]; }
+
+   void saveState(FILE* f) {
+      modelCoeff::saveState(f);
+      varmodel->saveState(f);
+   }
+
+   void loadState(FILE* f) {
+      modelCoeff::loadState(f);
+      varmodel->loadState(f);
+   }
+
    indepVarStr* varmodel=0;
 
 };
@@ -88,7 +88,7 @@ public:
       for(size_t row=0; row<par->nelem; row++) {
          if(missing[row]) {
             par->val[row] = Y.data[row] - resid->val[row];
-            resid->val[row] = R::rnorm( 0.0l, sqrt(1.0/varModel->weights[row]));
+            resid->val[row] = Rbayz::rng->rnorm( 0.0l, sqrt(1.0/varModel->weights[row]));
             Y.data[row] = par->val[row] + resid->val[row];
          }
          else {
@@ -97,10 +97,34 @@ public:
       }
    }
 
+   // state of the response model is Y (with sampled missing values), residuals and the weights
+   // in the residual variance model.
+   void saveState(FILE* f) {
+      writeStateVector(f, Y.data, Y.nelem);
+      writeStateVector(f, resid->val, resid->nelem);
+      varModel->saveState(f);
+   }
+
+   void loadState(FILE* f) {
+      readStateVector(f, Y.data, Y.nelem, "response");
+      readStateVector(f, resid->val, resid->nelem, "residuals");
+      varModel->loadState(f);
+   }
+
    void sampleHpars() {
       varModel->sample();
    }
 
+   // Method VB: the expected squared residuals are resid^2 plus their posterior variance, approximated
+   // as peff/Nobs times the residual variance (peff the effective number of parameters in the model,
+   // which is the sum of the leverages), and for missing data the full residual variance.
+   void vbResidVar(double peff) {
+      double var = varModel->par->val[0];
+      if(resid->vbVar.size() != resid->nelem) resid->vbVar.assign(resid->nelem, 0.0l);
+      for(size_t row=0; row<resid->nelem; row++)
+         resid->vbVar[row] = missing[row] ? var : var*peff/double(stats.Nobs);
+   }
+
    void restart() {
       varModel->restart();
    }
@@ -12,6 +12,7 @@
 
 #include <Rcpp.h>
 #include <cmath>
+#include <algorithm>
 #include "modelMatrix.h"
 #include "indepVarStr.h"
 #include "dataMatrix.h"
@@ -31,38 +32,58 @@ public:
       delete varmodel;
    }
    
-   // sample() now updated to handle zero variance (inf weight) from the variance model:
-   // - decorrect() runs to correct for old estimate, but skips if old one was already zero
-   // - for inf weight, regcoeff is set to zero, else it will go through the sampling procedure
-   // - correct() runs in case regcoeff != zero, but skips if it is zero
+   // sample() handles zero variance (inf weight) from the variance model by setting the regcoeff
+   // to zero, other regressions are updated with the fused update_column() from modelMatrix.
+   // With many observations per matrix row the sweep runs in the aggregated (per row) mode, with the
+   // xpx option on X'X (see begin_sweep in modelMatrix).
+   // With the block option adjacent columns are updated jointly with update_block(), a block
+   // with an inf weight is updated column by column.
    void sample() {
       double inf = std::numeric_limits<double>::infinity();
-      double lhs, rhs;
-      for(size_t k=0; k < M->ncol; k++) {
-         resid_decorrect(k);
-         if(varmodel->weights[k]==inf) {
-            par->val[k]=0;
+      begin_sweep();
+      size_t nb;
+      bool singleSite;
+      for(size_t start=0; start < M->ncol; start += blockSize) {
+         nb = std::min(blockSize, M->ncol - start);
+         singleSite = (nb==1) || Rbayz::rng->expectation;     // VB uses single-site updates
+         for(size_t k=start; k < start+nb && !singleSite; k++)
+            if(varmodel->weights[k]==inf) singleSite=true;
+         if(!singleSite) {
+            update_block(start, nb, varmodel->weights.data + start);
+            continue;
          }
-         else {
-            collect_lhs_rhs(lhs, rhs, k);
-            lhs += varmodel->weights[k];
-            par->val[k] = R::rnorm( (rhs/lhs), sqrt(1.0/lhs));
+         for(size_t k=start; k < start+nb; k++) {
+            if(varmodel->weights[k]==inf)
+               zero_column(k);
+            else
+               update_column(k, varmodel->weights[k]);
          }
-         resid_correct(k);
       }
-      // need some thinking how to store sample info in file; likely every "saved" cycle.
-      // main runs prepForOutput, and on a parVector main runs collectStats at the save intervals,
-      // or it needs a new mechanism to switch on saving samples from output (which can be generic feature).
+      end_sweep();
    }
 
    void sampleHpars() {
       varmodel->sample();
    }
 
+   void saveState(FILE* f) {
+      modelCoeff::saveState(f);
+      varmodel->saveState(f);
+   }
+
+   void loadState(FILE* f) {
+      modelCoeff::loadState(f);
+      varmodel->loadState(f);
+   }
+
    void restart() {
       varmodel->restart();
    }
 
+   // VB for IDEN and DIAG, the grid-LASSO and mixture classes override this
+   bool vbAvailable() { return true; }
+   double vbPriorPrec(size_t k) { return varmodel->weights[k]; }
+
    indepVarStr* varmodel;
 
 };
@@ -127,7 +148,7 @@ class modelRregGRL : public modelRreg {                                      //
          if(curr_grid == 0) prop_grid = 1;                           // at left extreme, move up
          else if (curr_grid == grid.last) prop_grid = grid.last - 1; // at right extreme, move down 
          else {                                                      // in between toss a coin how to move
-            if(R::runif(0,1) < 0.5) prop_grid = curr_grid-1;
+            if(Rbayz::rng->runif(0,1) < 0.5) prop_grid = curr_grid-1;
             else prop_grid = curr_grid + 1;
          }
          beta_diff = beta_scale*(grid.x[curr_grid]-grid.x[prop_grid]);
@@ -136,7 +157,7 @@ class modelRregGRL : public modelRreg {                                      //
             grid.logp[prop_grid] - grid.logp[curr_grid];
          if(curr_grid == 0 || curr_grid == grid.last) MHratio += loghalf;
          else if (prop_grid == 0 || prop_grid == grid.last) MHratio += logtwo;
-         if(MHratio > 0 || log(R::runif(0,1)) < MHratio ) { // accept
+         if(MHratio > 0 || log(Rbayz::rng->runif(0,1)) < MHratio ) { // accept
             beta_grid[k] = prop_grid;
             par->val[k] = beta_scale*grid.x[prop_grid];
             resid_fit_betaUpdate(beta_diff, k);
@@ -148,6 +169,8 @@ class modelRregGRL : public modelRreg {                                      //
       }
    }
 
+   bool vbAvailable() { return false; }
+
    // also sampleHpars needs to be re-defined, the version in the parent class calls the usual
    // varmodel->sample(), but here the varmodel->sampleScale() should be used.
    void sampleHpars() {
@@ -158,6 +181,17 @@ class modelRregGRL : public modelRreg {                                      //
       resid_fit_scaleUpdate(oldscale,sqrt(varmodel->par->val[0]));
    }
 
+   // the grid positions of the betas are additional state in the grid LASSO
+   void saveState(FILE* f) {
+      modelRreg::saveState(f);
+      writeStateVector(f, beta_grid.data, beta_grid.nelem);
+   }
+
+   void loadState(FILE* f) {
+      modelRreg::loadState(f);
+      readStateVector(f, beta_grid.data, beta_grid.nelem, "grid positions of " + par->Name);
+   }
+
    // Standard Bayesian LASSO-based grid
    /*
    struct {size_t n {7}; size_t mid {3}; size_t last {6};
@@ -191,12 +225,47 @@ class modelRregGRL : public modelRreg {                                      //
 
 };
 
+// Mixture (BayesC-pi) model: every column samples its class with the coefficient integrated out
+// (mixtVarStr::sampleClass) and then the coefficient given the class. Columns that stay in a null class
+// only cost the lhs/rhs collection, the residual update is skipped when the coefficient does not change.
 class modelRregMixt : public modelRreg {
 public:
    modelRregMixt(parsedModelTerm & pmdescr, modelResp * rmod)
       : modelRreg(pmdescr, rmod) {
-      varmodel = new mixtVarStr(pmdescr, this->par);
+      mixtvar = new mixtVarStr(pmdescr, this->par);
+      varmodel = mixtvar;
+      // start the variance at a roughly right scale: 0.5 * (raw response var) divided by the expected
+      // sum of relative variances over the columns.
+      double expectedVars=0.0l;
+      for(size_t c=0; c < mixtvar->Ncat; c++) expectedVars += mixtvar->par->val[c+1] * mixtvar->Vars[c];
+      mixtvar->par->val[0] = 0.5*rmod->stats.var/(double(M->ncol)*expectedVars);
+      mixtvar->restart();
    }
+
+   void sample() {
+      double inf = std::numeric_limits<double>::infinity();
+      double xwr, xwx, rhs, lhs, beta_old, beta_new;
+      begin_sweep();
+      for(size_t k=0; k < M->ncol; k++) {
+         beta_old = par->val[k];
+         collect_lhs_rhs(xwx, xwr, k);
+         rhs = xwr + beta_old * xwx;
+         mixtvar->sampleClass(k, xwx, rhs);
+         if(varmodel->weights[k]==inf)
+            beta_new = 0.0l;
+         else {
+            lhs = xwx + varmodel->weights[k];
+            beta_new = Rbayz::rng->rnorm(rhs/lhs, sqrt(1.0l/lhs));
+         }
+         par->val[k] = beta_new;
+         column_axpy(k, beta_new - beta_old);
+      }
+      end_sweep();
+   }
+
+   bool vbAvailable() { return false; }
+
+   mixtVarStr* mixtvar;
 };
 
 #endif /* modelRreg */
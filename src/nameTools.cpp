@@ -24,7 +24,9 @@ void CharVec2cpp(std::vector<std::string> & CppStrings, Rcpp::CharacterVector RS
 // getMatrixNames: attempts to retrieve row or col-names (dim=1 or 2) from an R matrix
 // and return in an c++ vector<string>.
 // Failure can be checked by the return vector to have size() 0.
-std::vector<std::string> getMatrixNames(Rcpp::NumericMatrix & mat, int dim) {
+// The matrix is passed as SEXP so that it works for numeric and integer matrices.
+std::vector<std::string> getMatrixNames(SEXP matrix, int dim) {
+   Rcpp::RObject mat(matrix);
    std::vector<std::string> names;
    if (mat.hasAttribute("dimnames")) {
       Rcpp::List dimnames = Rcpp::as<Rcpp::List>(mat.attr("dimnames"));
@@ -72,3 +74,21 @@ int findDataColumn(std::string name) {
    else
       return col;
 }
+
+// Report levels (labels) that could not be matched: message and the first 10 unmatched labels go in
+// the Messages, and it ends with needStop set and an error thrown with errorText.
+void stopUnmatchedLevels(const std::string & message, const std::vector<std::string> & unmatched,
+                         const std::string & errorText) {
+   Rbayz::Messages.push_back(message);
+   size_t nshow = std::min( unmatched.size(), size_t(10) );
+   std::string s;
+   for(size_t i=0; i< nshow; i++) {
+      s += unmatched[i] + " ";
+   }
+   if ( unmatched.size() > nshow ) {
+      s += " [+ " + std::to_string(unmatched.size() - nshow) + " more]";
+   }
+   Rbayz::Messages.push_back(s);
+   Rbayz::needStop = true;
+   throw generalRbayzError(errorText);
+}
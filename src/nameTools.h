@@ -15,8 +15,10 @@
 #include "dataFactor.h"
 
 void CharVec2cpp(std::vector<std::string> & labels, Rcpp::CharacterVector templabels);
-std::vector<std::string> getMatrixNames(Rcpp::NumericMatrix & mat, int dim);
+std::vector<std::string> getMatrixNames(SEXP matrix, int dim);
 std::vector<std::string> generateLabels(std::string text, int n);
 int findDataColumn(std::string name);
+void stopUnmatchedLevels(const std::string & message, const std::vector<std::string> & unmatched,
+                         const std::string & errorText);
 
 #endif /* nameTools_h */
@@ -175,7 +175,7 @@ void optionsInfo::constr(std::string fname, std::string optstring)
          else {                                            // varstruct with options within () or []
             varstructList[i].keyw=varstructStrings[i].substr(0,parenth);
             std::string optstring=varstructStrings[i].substr(parenth+1,(varstructStrings[i].size()-parenth-2));
-            std::vector<std::string> optStrings = splitString(optstring,",");
+            std::vector<std::string> optStrings = splitStringNested(optstring);     // vars(..,..) has nested commas
             varstructList[i].varOptions.resize(optStrings.size());
             for(size_t j=0; j<optStrings.size(); j++) {                         // parse and store info from each
                equal2=optStrings[j].find('=');                                  // optStrings in the varOptions slots.
@@ -194,8 +194,8 @@ void optionsInfo::constr(std::string fname, std::string optstring)
                }
                else if (equal2==std::string::npos && parenth2!=std::string::npos) {
                   varstructList[i].varOptions[j].format=5;
-                  varstructList[i].varOptions[j].keyw=optStrings[j].substr(0,parenth);
-                  varstructList[i].varOptions[j].valstring=optStrings[j].substr(parenth+1,optlen-parenth-2);
+                  varstructList[i].varOptions[j].keyw=optStrings[j].substr(0,parenth2);
+                  varstructList[i].varOptions[j].valstring=optStrings[j].substr(parenth2+1,optlen-parenth2-2);
                }
             }
          }
@@ -238,7 +238,7 @@ void optionsInfo::constr(std::string fname, std::string optstring)
       if(varstructList[i].keyw=="MIXT") {
          bool vars_present=false;
          bool counts_present=false;
-         for(size_t j=0; j<varstructList[i].varOptions.size(); i++) {
+         for(size_t j=0; j<varstructList[i].varOptions.size(); j++) {
             if (varstructList[i].varOptions[j].keyw=="vars") vars_present=true;
             if (varstructList[i].varOptions[j].keyw=="counts") counts_present=true;
          }
@@ -111,7 +111,14 @@ private:
       {"KERN","dimp",false},
       {"rn","alpha_est",false},
       {"rn","alpha_save",false},
-      {"rn","idimp",false}
+      {"rn","idimp",false},
+      {"rn","precision",false},
+      {"rr","precision",false},
+      {"rr","block",false},
+      {"rr","threads",false},
+      {"fx","threads",false},
+      {"rn","threads",false},
+      {"rr","xpx",false}
    };
    std::map<std::string, int> option2format
    {
@@ -125,7 +132,11 @@ private:
       std::make_pair("dimp",3),
       std::make_pair("vdimp",3),
       std::make_pair("alpha_est",4),
-      std::make_pair("alpha_save",4)
+      std::make_pair("alpha_save",4),
+      std::make_pair("precision",2),
+      std::make_pair("block",3),
+      std::make_pair("threads",3),
+      std::make_pair("xpx",4)
    };
 public:
    optionsInfo() { }
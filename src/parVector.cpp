@@ -5,6 +5,7 @@
 #include "Rbayz.h"
 #include "rbayzExceptions.h"
 #include "parVector.h"
+#include "checkpointTools.h"
 using Rsize_t = long int;
 
 // common things for all contructors, this one is called at the end of every
@@ -61,9 +62,11 @@ void parVector::common_constructor_items(parsedModelTerm & modeldescr, std::stri
              ") may need large memory; you could use 'save' instead to store samples in a file");
    }
    // check save option and open samples file if requested
+   fileTag = Rbayz::chainTag;
    optionSpec save_opt = modeldescr.allOptions["save"];
    if(save_opt.isgiven && save_opt.valbool==true) {
-      if( (openSamplesFile()) > 0) {
+      // when resuming the samples file is re-opened later from loadState(), it should not be overwritten
+      if( !Rbayz::resumeRun && (openSamplesFile()) > 0) {
          throw generalRbayzError("Unable to open file for writing samples for " + Name);
       }
       saveSamples=true;
@@ -159,10 +162,16 @@ void parVector::collectStats() {
    }
 }
 
+// Samples are written in binary chunks by a background thread, see samplesWriter.h.
 int parVector::openSamplesFile() {
-   std::string filename = "samples." + Name + ".txt";
-   samplesFile = fopen(filename.c_str(),"w"); 
-   return (samplesFile==0) ? 1 : 0; 
+   std::string filename = "samples." + Name + fileTag + ".bin";
+   try {
+      samplesFile = new samplesWriter(filename, Name, Labels, false);
+   }
+   catch (generalRbayzError & err) {
+      samplesFile = 0;
+   }
+   return (samplesFile==0) ? 1 : 0;
 }
 
 void parVector::writeSamples(int cycle) {
@@ -173,16 +182,85 @@ void parVector::writeSamples(int cycle) {
          throw generalRbayzError("Unable to open file for writing samples for " + Name);
       }
    }
-   if(saveSamples) {
-      fprintf(samplesFile,"%d",cycle);
-      for(size_t k=0; k<nelem; k++)
-         fprintf(samplesFile," %g",Values[k]);
-      fprintf(samplesFile,"\n");
+   if(saveSamples) samplesFile->add(cycle, Values.data);
+}
+
+// At the end of the chain the last chunk is written and write errors are reported, otherwise
+// a full disk would only leave a truncated samples file.
+void parVector::finishSamples() {
+   if(samplesFile == 0) return;
+   samplesFile->flush();
+   if(samplesFile->failed())
+      throw generalRbayzError("Error writing samples file for " + Name + ", the file is incomplete");
+}
+
+// Save and load all values and posterior statistics for a checkpoint. For the samples file the
+// size written so far is stored, a resumed run removes what is written after the checkpoint and
+// continues writing from there.
+void parVector::saveState(FILE* f) {
+   writeStateString(f, Name);
+   writeStateVector(f, val, nelem);
+   writeStateVector(f, postMean.data, nelem);
+   writeStateVector(f, postVar.data, nelem);
+   writeStateVector(f, sumSqDiff.data, nelem);
+   writeState(f, &count_collect_stats, 1);
+   int64_t offset=0;
+   if(samplesFile != 0) offset = samplesFile->flush();
+   writeState(f, &offset, 1);
+}
+
+void parVector::loadState(FILE* f) {
+   std::string fileName = readStateString(f);
+   if(fileName != Name)
+      throw generalRbayzError("Checkpoint file does not match the model: found parameter " + fileName +
+                              " where " + Name + " is expected");
+   readStateVector(f, val, nelem, Name);
+   readStateVector(f, postMean.data, nelem, Name);
+   readStateVector(f, postVar.data, nelem, Name);
+   readStateVector(f, sumSqDiff.data, nelem, Name);
+   readState(f, &count_collect_stats, 1);
+   int64_t offset;
+   readState(f, &offset, 1);
+   if(saveSamples) resumeSamplesFile(offset);
+}
+
+// Keep the first 'offset' bytes of the existing samples file and open it to continue writing.
+// It is done by copying to a temporary file, which works the same on all platforms.
+void parVector::resumeSamplesFile(int64_t offset) {
+   if(samplesFile != 0) {
+      delete samplesFile;
+      samplesFile=0;
+   }
+   std::string filename = "samples." + Name + fileTag + ".bin";
+   std::string tempname = filename + ".tmp";
+   FILE* oldFile = fopen(filename.c_str(),"rb");
+   FILE* newFile = fopen(tempname.c_str(),"wb");
+   if(newFile==0) throw generalRbayzError("Unable to open file for writing samples for " + Name);
+   if(oldFile != 0) {
+      char buffer[65536];
+      int64_t todo=offset;
+      while(todo > 0) {
+         size_t nread = fread(buffer, 1, (todo < 65536) ? size_t(todo) : 65536, oldFile);
+         if(nread==0) break;
+         fwrite(buffer, 1, nread, newFile);
+         todo -= int64_t(nread);
+      }
+      fclose(oldFile);
+      if(todo > 0) Rbayz::Messages.push_back("Warning: samples file for " + Name +
+                                             " is shorter than at the checkpoint, samples may be missing");
+   }
+   fclose(newFile);
+   remove(filename.c_str());
+   if(rename(tempname.c_str(), filename.c_str()) != 0)
+      throw generalRbayzError("Unable to resume samples file for " + Name);
+   if(offset==0) {           // nothing was written before the checkpoint, start with a new header
+      if(openSamplesFile() > 0) throw generalRbayzError("Unable to open file for writing samples for " + Name);
    }
+   else samplesFile = new samplesWriter(filename, Name, Labels, true);
 }
 
 parVector::~parVector() {
-   if(samplesFile != 0) fclose(samplesFile);
+   if(samplesFile != 0) delete samplesFile;
 }
 
 // Function to write name, size and first elements of a parVector (for debugging purposes),
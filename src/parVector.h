@@ -14,6 +14,7 @@
 #include <vector>
 #include "simpleVector.h"
 #include "parsedModelTerm.h"
+#include "samplesWriter.h"
 
 class parVector {
 
@@ -32,8 +33,10 @@ public:
    simpleDblVector postVar;
    simpleDblVector sumSqDiff;
    size_t count_collect_stats=0;
+   std::vector<double> vbVar;   // method VB: posterior variances (only allocated with VB)
    bool saveSamples = false;
-   FILE* samplesFile=0;
+   samplesWriter* samplesFile=0;
+   std::string fileTag="";   // added to samples file name to distinguish chains
    parVector(parsedModelTerm & modeldescr, double initval);
    parVector(parsedModelTerm & modeldescr, double initval, std::string namePrefix);
    parVector(parsedModelTerm & modeldescr, double initval, Rcpp::CharacterVector& labels, std::string namePrefix);
@@ -44,6 +47,10 @@ public:
    void collectStats();
    int openSamplesFile();
    void writeSamples(int);
+   void finishSamples();
+   void saveState(FILE* f);
+   void loadState(FILE* f);
+   void resumeSamplesFile(int64_t offset);
    ~parVector();
    
 };
@@ -151,8 +151,10 @@ std::string convertFormula(Rcpp::Formula f) {
 
 // Return R object type (type of variable):
 // 1: Factor, 2: IntegerVector, 3: NumericVector, 4: CharacterVector, 5: LogicalVector
-// 6: (Numeric/double or integer) Matrix, 7: DataFrame, 8: List, 9: all other
+// 6: (Numeric/double or integer) Matrix, 7: DataFrame, 8: List, 9: all other, 10: sparse dgCMatrix
 int getVariableType(Rcpp::RObject x) {
+   if(Rf_isS4(x) && Rf_inherits(x, "dgCMatrix"))   // sparse matrix from the Matrix package
+      return(10);
    if( (Rcpp::is<Rcpp::NumericVector>(x) || Rcpp::is<Rcpp::IntegerVector>(x)) && Rf_isMatrix(x))
       return(6);
    if(Rcpp::is<Rcpp::NumericVector>(x) && !Rf_isMatrix(x))
@@ -169,19 +171,19 @@ int getVariableType(Rcpp::RObject x) {
 }
 
 // Search and retrieve a variable 'name' by searching in the Rbayz::mainData or in the R
-// environment, and return it as an RObject. If not found return R_NilValue.
+// environment of the model formula (Rbayz::modelEnv and its enclosing environments, so also
+// the global environment), and return it as an RObject. If not found return R_NilValue.
 Rcpp::RObject getVariableObject(std::string name) {
-   bool foundInEnv;
    Rcpp::RObject tempObject;
-   Rcpp::Environment Renv;
    int colnr = findDataColumn(name);    // returns -1 if not found
    if(colnr>=0) {                       // found in data frame
       tempObject = Rcpp::as<Rcpp::RObject>(Rbayz::mainData[colnr]);
    }
    else {                               // search in R environment
-      foundInEnv = Renv.exists(name);
-      if(foundInEnv) tempObject = Renv[name];
-      else return R_NilValue;           // not found in data frame or environment!
+      SEXP envObject = Rf_findVar(Rf_install(name.c_str()), Rbayz::modelEnv);
+      if(envObject == R_UnboundValue) return R_NilValue;   // not found in data frame or environment!
+      if(TYPEOF(envObject) == PROMSXP) envObject = Rf_eval(envObject, Rbayz::modelEnv);
+      tempObject = envObject;
    }
    return tempObject;
 }
@@ -12,6 +12,7 @@
 #include <Rcpp.h>
 #include "parseFunctions.h"
 #include "rbayzExceptions.h"
+#include "Rbayz.h"
 
 /* GenericPrior object: to hold prior information in a generic way, basically
    a map of (parameter, value) pairs and a "dist" string for the distribution.
@@ -86,7 +87,7 @@ public:
          }
          ssq += dfprior*scale;
          dftotal = dfprior+double(n);
-         return(ssq/R::rchisq(dftotal));
+         return(ssq/Rbayz::rng->rchisq(dftotal));
       }
       else {
          std::string s = "Cannot sample variance with prior distribution <" + dist + "> in model-term " + modelName;
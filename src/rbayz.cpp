@@ -7,19 +7,15 @@
 #include "parsedModelTerm.h"
 #include "modelBase.h"
 #include "modelResp.h"
-#include "modelMean.h"
-#include "modelFixf.h"
-#include "modelRanfi.h"
-#include "modelFreg.h"
-#include "modelRreg.h"
-#include "modelRanfc.h"
-#include "modelMixt.h"
+#include "mcmcChain.h"
+#include "convergenceMonitor.h"
 #include "rbayzExceptions.h"
 #include "simpleMatrix.h"
 #include "simpleVector.h"
 #include "modelVar.h"
 #include "indepVarStr.h"
 #include <unistd.h>
+#include <thread>
 
 // [[Rcpp::plugins("cpp11")]]
 
@@ -29,11 +25,17 @@ std::vector<parVector**> Rbayz::parList;
 std::vector<std::string> Rbayz::Messages;
 bool Rbayz::needStop=false;
 Rcpp::DataFrame Rbayz::mainData;
-Rcpp::IntegerVector Rbayz::RunInfo(9);
+Rcpp::IntegerVector Rbayz::RunInfo(11);
+thread_local rbayzRNG* Rbayz::rng=0;
+std::string Rbayz::chainTag="";
+bool Rbayz::resumeRun=false;
+Rcpp::Environment Rbayz::modelEnv;
 
 // [[Rcpp::export]]
 Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputData,
-                     Rcpp::IntegerVector chain, SEXP methodArg, int verbose,
+                     Rcpp::IntegerVector chain, SEXP methodArg, int verbose, int nchains,
+                     int checkpoint, bool resume, double target_ess, double target_mcse,
+                     bool trace_float, double trace_limit, bool joint_fixed,
                      Rcpp::Nullable<Rcpp::List> initVals_ = R_NilValue
                      )
 //                   note VE and method are strings, it will be converted below
@@ -45,18 +47,20 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
    Rbayz::parList.clear();
    Rbayz::Messages.clear();
    Rbayz::needStop=false;
+   Rbayz::resumeRun=resume;
    Rbayz::mainData=inputData;
+   SEXP formulaEnv = Rf_getAttrib(modelFormula, Rf_install(".Environment"));
+   Rbayz::modelEnv = (TYPEOF(formulaEnv)==ENVSXP) ? Rcpp::Environment(formulaEnv) : Rcpp::Environment::global_env();
    Rbayz::RunInfo.fill(0);
    Rbayz::RunInfo.names() = Rcpp::CharacterVector::create("Nerror","Nwarning","Nnote",
                             "Data Size","Nmissing","Nparameters","Chain Length","Burn-In",
-                            "Chain Skip");
+                            "Chain Skip","Nchains","Cycles Run");
 
    // rbayz retains a small string describing last executed code that is sometimes added in errors
    std::string lastDone;
 
    // some variable are outside try{} because associated memory alloc needs to be cleaned up in catch{}
-   modelResp* modelR = 0;
-   std::vector<modelBase *> model;
+   std::vector<mcmcChain *> chains;
 
    if (verbose > 0) Rcpp::Rcout << "R/bayz 0.12.00\n";
 
@@ -71,73 +75,34 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
       lastDone="Parsing model";
       if (verbose > 1) Rcpp::Rcout << "Parsing model done\n";
 
-      // build response object - including response variance structure
+      // build nchains replicas of the model, each chain with its own random number stream from
+      // a seed drawn from R's generator; building uses R and is done in the main thread.
       std::string VEstr =  Rcpp::as<std::string>(VE);
-      parsedModelTerm parsedResponseVariable(modelTerms[0], VEstr);
-      // here still need to add selecting different response objects based on variance structure
-      modelR = new modelResp(parsedResponseVariable);   
-      if (verbose > 1) Rcpp::Rcout << "Response model-object done\n";
-
-      // Build vector of modelling objects from RHS terms (loop from term=1)
-      if(verbose>2) Rcpp::Rcout << "Starting on building model objects ...\n";
-      for(size_t term=1; term<modelTerms.size(); term++) {
-         parsedModelTerm pmt(modelTerms[term]);
-         if(verbose>2) Rcpp::Rcout << " ... building term " << term << " " << pmt.funcName << "()\n";
-         if(pmt.funcName=="mn") {
-            if(pmt.variableString=="1") model.push_back(new modelMean(pmt, modelR));
-         }
-         else if(pmt.funcName=="fx") {
-            model.push_back(new modelFixf(pmt, modelR));
-         }
-         else if(pmt.funcName=="rn") {
-            if(pmt.varianceStruct=="IDEN" || pmt.varianceStruct=="notgiven") {
-               model.push_back(new modelRanfi_iden(pmt, modelR));
-            }
-            else if (pmt.varianceStruct=="1kernel") {
-               model.push_back(new modelRanfc1(pmt, modelR));
-            }
-            else if (pmt.varianceStruct=="kernels") {
-               // Here default should become not merging kernels, unless user specified merging.
-               // However, the code for not merging is not yet ready, so for now force merging.
-               // [ToDo] finish the code for not merging kernels in modelRanfck.
-//               if (pmt.allOptions["mergeKernels"].isgiven && pmt.allOptions["mergeKernels"].valbool)
-                  model.push_back(new modelRanfc1(pmt, modelR));
-//               else 
-//                  model.push_back(new modelRanfck(pmt, modelR));
-            }
-            else {
-               throw generalRbayzError("There is no class to model rn(...) with Variance structure " + pmt.allOptions["V"].valstring);
-            }
-         }
-         else if (pmt.funcName=="rr") {
-            // Note: varianceStruct DIAG, LASS, MIXT are always single (for now) - see parsedModelTerm.
-            //       If there would be multiple with a DIAG it would be annotated as "mixed" varianceStruct.
-            if(pmt.varianceStruct=="IDEN" || pmt.varianceStruct=="notgiven")
-               model.push_back(new modelRregIden(pmt, modelR));
-            else if (pmt.varianceStruct=="DIAG")
-               model.push_back(new modelRregDiag(pmt, modelR));
-            else if (pmt.varianceStruct=="LASS")
-               model.push_back(new modelRregGRL(pmt, modelR));
-            else if (pmt.varianceStruct=="MIXT") {
-               modelRreg* rrmodel = new modelRregMixt(pmt, modelR);
-               model.push_back(rrmodel);
-               model.push_back(new modelMixt(pmt, rrmodel));
-            }
-            else
-               throw generalRbayzError("There is no class to model rr(...) with Variance structure " + pmt.allOptions["V"].valstring);
-         }
-         else if (pmt.funcName=="rg") {    // [ToDo] work on adding rg() versions
-            if(pmt.variablePattern=="onevar")
-               model.push_back(new modelFreg(pmt, modelR));
-//            else if (pmt.variablePattern="nestedreg")
-//             need a new model object for the nested regression
-            else
-               throw generalRbayzError("Regression with the variable syntax " + pmt.variableString + " not yet supported\n");
-         }
-         else {
-           throw generalRbayzError("Unknown model-function \'" + pmt.funcName + "\' at "+pmt.shortModelTerm);
-         }
-      } // end for(term ...) to build model
+      if (nchains < 1) throw (generalRbayzError("The number of chains (nchains) must be 1 or more"));
+      if (checkpoint < 0) throw (generalRbayzError("The checkpoint interval is negative"));
+      if (target_ess < 0 || target_mcse < 0) throw (generalRbayzError("The target_ess or target_mcse is negative"));
+      if (resume && initVals_.isNotNull())
+         throw (generalRbayzError("Cannot use both resume and init, resume continues from the checkpoint files"));
+      uint64_t seed = (uint64_t(R::runif(0,1)*4294967296.0) << 32) | uint64_t(R::runif(0,1)*4294967296.0);
+      size_t nMessagesChain1=0;
+      for(int c=0; c<nchains; c++) {
+         Rbayz::chainTag = (nchains>1) ? ".chain" + std::to_string(c+1) : "";
+         chains.push_back(new mcmcChain(c, seed));
+         chains[c]->checkpointInterval = checkpoint;
+         chains[c]->checkpointFile = "checkpoint" + Rbayz::chainTag + ".bin";
+         chains[c]->targetEss = target_ess / double(nchains);   // the ESS target is shared over chains
+         chains[c]->targetMcse = target_mcse * std::sqrt(double(nchains));
+         chains[c]->jointFixed = joint_fixed;
+         chains[c]->buildModel(modelTerms, VEstr, (c==0)? verbose : 0);
+         // model-building messages are the same for all chains, only keep the ones of the first chain
+         if(c==0) nMessagesChain1 = Rbayz::Messages.size();
+         else Rbayz::Messages.resize(nMessagesChain1);
+         if(Rbayz::needStop) break;
+      }
+      Rbayz::chainTag = "";
+      // parList and modelR of the first chain are used for checks and for building output
+      Rbayz::parList = chains[0]->parList;
+      modelResp* modelR = chains[0]->modelR;
       lastDone="Model building";
       if (verbose>1) Rcpp::Rcout << "Model building done\n";
       if(Rbayz::needStop)
@@ -165,38 +130,10 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
 
       // Make parameter name disambiguation - this is moved parVector class.
 
-      // Load initial values if given. An easy start is to only allow init-values from a run
-      // with the same model - so that parameter-names and sizes all align.
+      // Load initial values if given (see mcmcChain::loadInitValues), all chains start from the same values.
       if(initVals_.isNotNull()) {
          Rcpp::List initVals(initVals_);
-         Rcpp::DataFrame old_parameters = Rcpp::as<Rcpp::DataFrame>(initVals["Parameters"]);
-         Rcpp::CharacterVector old_par_names = old_parameters["Param"];
-         Rcpp::IntegerVector old_par_sizes = old_parameters["Size"];
-         // check alignment of names and sizes between old and current build model
-         bool match=true;
-         if((size_t) old_par_sizes.size() == Rbayz::parList.size()){
-            for(size_t i=0; i<Rbayz::parList.size(); i++) {
-               if( ! (old_par_names[i] == (*(Rbayz::parList[i]))->Name && 
-                        (size_t) old_par_sizes[i] == (*(Rbayz::parList[i]))->nelem) ) match=false;
-            }
-         }
-         else
-            match=false;
-         if(match) {
-            Rcpp::List old_estimates = initVals["Estimates"];
-            for(size_t par=0; par<Rbayz::parList.size(); par++) {                     // for now loading fitted values from Estimates list,
-               Rcpp::DataFrame par_data = Rcpp::as<Rcpp::DataFrame>(old_estimates[par]);    // but they are also stored in Residuals. 
-               Rcpp::NumericVector par_pm = par_data["PostMean"];
-               for(size_t row=0; row < (*(Rbayz::parList[par]))->nelem; row++)
-                  (*(Rbayz::parList[par]))->val[row] = par_pm[row];
-            }
-            modelR->readjResid();  // residuals need to be reset to match loaded fitted values.
-            modelR->restart();
-            for(size_t mod=0; mod<model.size(); mod++) model[mod]->restart();
-         }
-         else {  // no match
-            throw (generalRbayzError("Initialisation values cannot be used because names or sizes don't match"));
-         }      // this could also be a warning, but there is no nice way to count and handle warnings
+         for(size_t c=0; c<chains.size(); c++) chains[c]->loadInitValues(initVals);
          Rcpp::Rcout << "Chain has been initialized with previous estimates\n";
       }
       if (verbose>4) Rcpp::Rcout << "Passed check init values\n";
@@ -221,6 +158,7 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
       Rbayz::RunInfo["Chain Length"] = chain[0];
       Rbayz::RunInfo["Burn-In"] = chain[1];
       Rbayz::RunInfo["Chain Skip"] = chain[2];
+      Rbayz::RunInfo["Nchains"] = nchains;
       if (verbose>4) Rcpp::Rcout << "Chain checks done\n";
 
       // Find the number of traced parameters and set-up matrix to store samples of traced parameters
@@ -239,82 +177,56 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
          }
       }
       if(verbose>0) Rcpp::Rcout << "\n";
-      Rcpp::NumericMatrix tracedSamples(nSamples,nTracedParam);
-
-      // to show convergence set "nShow" interval and make vector to hold previously shown solutions
-      int nShow = chain[0]/10;
-      if( nShow < 1) nShow=1;
-      int collect_first_conv = chain[0]/20;
-      if (collect_first_conv < 1) collect_first_conv=1;
-      Rcpp::NumericVector prevShowConv(int(nTracedParam), 0.5l);
+      // traces above the memory limit (in MB, shared over chains) are stored in files traces[.chainN].bin
+      if (trace_limit < 0) throw (generalRbayzError("The trace_limit is negative"));
+      for(size_t c=0; c<chains.size(); c++) {
+         std::string traceFile = (nchains>1) ? "traces.chain" + std::to_string(c+1) + ".bin" : "traces.bin";
+         chains[c]->prepareRun(chain[0], chain[1], chain[2], nSamples, trace_float, trace_limit/double(nchains), traceFile);
+      }
+      if(resume) {
+         for(size_t c=0; c<chains.size(); c++) chains[c]->loadCheckpoint();
+         if(verbose>0) Rcpp::Rcout << "Resuming from checkpoint at cycle " << chains[0]->startCycle << "\n";
+      }
       lastDone="Preparing to run MCMC";
       if (verbose>1) Rcpp::Rcout << "Preparing to run MCMC done\n";
 
-      // Run the MCMC chain for method "Bayes" and "BLUPMC"
+      // Run the MCMC chains for method "Bayes" and "BLUPMC", or the VB iterations for method "VB"
       // ------------------
+      // The first chain runs in the main thread and shows progress (when verbose>0), other chains run
+      // in separate threads. All chains use runSafely() and errors are checked after all threads joined.
 
       std::string method = Rcpp::as<std::string>(methodArg);
-      if (method=="Bayes" || method=="BLUPMC") {
-         if(verbose>0) {
-            Rcpp::Rcout << "Cycle avgChange\n";
+      if (!(method=="Bayes" || method=="BLUPMC" || method=="VB"))
+         throw(generalRbayzError("Unknown method \"" + method + "\", use \"Bayes\", \"BLUPMC\" or \"VB\""));
+      if (method=="VB") {
+         // Variational Bayes runs in the main thread on the first chain, the chain length is the
+         // maximum number of iterations.
+         if (nchains > 1) throw(generalRbayzError("Method VB runs a single chain, use nchains=1"));
+         size_t nMessagesBeforeRun = Rbayz::Messages.size();
+         chains[0]->runSafely(method, verbose);
+         Rbayz::rng = 0;
+         if(chains[0]->errorMessage != "") Rbayz::Messages.push_back(chains[0]->errorMessage);
+         if(Rbayz::Messages.size() > nMessagesBeforeRun && chains[0]->errorMessage != "")
+            throw(generalRbayzError("Running VB failed"));
+         Rbayz::RunInfo["Cycles Run"] = chains[0]->lastCycle;
+      }
+      else if (method=="Bayes" || method=="BLUPMC") {
+         if(verbose>0 && nchains>1) Rcpp::Rcout << "Running " << nchains << " chains, showing progress of chain 1\n";
+         size_t nMessagesBeforeRun = Rbayz::Messages.size();
+         std::vector<std::thread> chainThreads;
+         for(size_t c=1; c<chains.size(); c++)
+            chainThreads.push_back(std::thread(&mcmcChain::runSafely, chains[c], method, 0));
+         chains[0]->runSafely(method, verbose);
+         for(size_t t=0; t<chainThreads.size(); t++) chainThreads[t].join();
+         Rbayz::rng = 0;
+         for(size_t c=0; c<chains.size(); c++) {
+            if(chains[c]->errorMessage != "") Rbayz::Messages.push_back(chains[c]->errorMessage);
          }
-         for (int cycle=1, save=0; cycle <= chain[0]; cycle++) {
-            modelR->sample();
-            for(size_t mt=0; mt<model.size(); mt++) model[mt]->sample();
-            if(method=="Bayes") {
-               modelR->sampleHpars();
-               for(size_t mt=0; mt<model.size(); mt++) model[mt]->sampleHpars();
-            }
-            // At the 'skip' intervals and after burn-in:
-            // 1) update posterior statistics using collectStats();
-            // 2) save MCMC samples in memory for the 'traced' parameters;
-            // 3) save MCMC samples on disk for parameters with 'saveSamples' option
-            if ( (cycle > chain[1]) && (cycle % chain[2] == 0) ) {
-               for(size_t mt=0; mt<model.size(); mt++) model[mt]->prepForOutput();
-               for(size_t i=0; i<Rbayz::parList.size(); i++) (*(Rbayz::parList[i]))->collectStats();
-               for(size_t i=0, col=0; i<Rbayz::parList.size(); i++) {
-                  if( (*(Rbayz::parList[i]))->traced ) {
-                     for(size_t j=0; j< (*(Rbayz::parList[i]))->nelem; j++) {
-                        tracedSamples(save,col) = (*(Rbayz::parList[i]))->val[j]; col++;
-                     }
-                  }
-                  if( (*(Rbayz::parList[i]))->saveSamples ) {
-                     (*(Rbayz::parList[i]))->writeSamples(cycle);
-                  }
-               }
-               save++;  // save is counter for output (saved) cycles
-            }
-            // at 'collect_first_conv' cycle store parameter values in prevShowConv to allow computing
-            // first convergence; then at 'nShow' intervals show convergence on screen (when verbose > 0).
-            if (cycle == collect_first_conv) {
-               for(size_t i=0, col=0; i<Rbayz::parList.size(); i++) {
-                  if( (*(Rbayz::parList[i]))->traced ) {
-                     for(size_t j=0; j< (*(Rbayz::parList[i]))->nelem; j++) {                        
-                        prevShowConv[col] = (*(Rbayz::parList[i]))->val[j];
-                        col++;
-                     }
-                  }
-               }
-            }
-            if (cycle % nShow == 0 && verbose>0) {
-               Rcpp::Rcout << cycle;
-               double conv_change=0.0l, conv_denom=0.0l, postmean;
-               for(size_t i=0, col=0; i<Rbayz::parList.size(); i++) {
-                  if( (*(Rbayz::parList[i]))->traced ) {
-                     for(size_t j=0; j< (*(Rbayz::parList[i]))->nelem; j++) {
-                        if (save==0) postmean = (*(Rbayz::parList[i]))->val[j];  // if nothing saved yet, using sampled
-                        else postmean = (*(Rbayz::parList[i]))->postMean[j];     // value instead of postmean.
-                        conv_change += abs(prevShowConv[col] - postmean);
-                        conv_denom += abs(prevShowConv[col]);
-                        prevShowConv[col] = postmean;
-                        col++;
-                     }
-                  }
-               }
-               conv_change /= conv_denom;
-               Rcpp::Rcout << " " << conv_change << "\n";
-            }
-         } // end for(cycle ...)
+         if(Rbayz::Messages.size() > nMessagesBeforeRun)
+            throw(generalRbayzError("Running MCMC failed in one or more chains"));
+         int cyclesRun=0;
+         for(size_t c=0; c<chains.size(); c++) if(chains[c]->lastCycle > cyclesRun) cyclesRun = chains[c]->lastCycle;
+         Rbayz::RunInfo["Cycles Run"] = cyclesRun;
       }
 
 /*    else if (method=="BLUP") {     // insert here BLUP version
@@ -324,6 +236,9 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
       lastDone="Finished running MCMC";
       if (verbose>1) Rcpp::Rcout << "Finished running MCMC\n";
 
+      // Pool posterior statistics of all chains in the parameter vectors of the first chain.
+      mergeChainStats(chains);
+
       // Build tables to go in the output:
       // ---------------------------------
 
@@ -376,8 +291,50 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
             }
          }
       }
-      Rcpp::colnames(tracedSamples) = sampleColNames;
-      Rcpp::rownames(tracedSamples) = Rcpp::as<Rcpp::CharacterVector>(outputCycleNumbers); 
+      // Samples of all chains are stacked; with multiple chains samples are also given per chain in ChainSamples.
+      // Chains that stopped on convergence targets only have their first nSaved samples filled.
+      // When traces are stored in files they are not copied, the output has the file information in
+      // TraceFiles and R function getSamples() reads them.
+      bool tracesInFiles = chains[0]->traces.spilled;
+      size_t nStacked=0;
+      for(size_t c=0; c<chains.size(); c++) nStacked += chains[c]->nSaved;
+      if(tracesInFiles) nStacked=0;
+      Rcpp::NumericMatrix tracedSamples(nStacked,nTracedParam);
+      Rcpp::CharacterVector sampleCycleNames = Rcpp::as<Rcpp::CharacterVector>(outputCycleNumbers);
+      Rcpp::CharacterVector stackedRowNames;
+      Rcpp::List chainSamples = Rcpp::List::create();
+      Rcpp::CharacterVector traceFileNames;
+      Rcpp::IntegerVector traceFileRows;
+      for(size_t c=0, firstRow=0; c<chains.size(); c++) {
+         size_t nSaved = chains[c]->nSaved;
+         if(tracesInFiles) {
+            traceFileNames.push_back(chains[c]->traces.fileName);
+            traceFileRows.push_back(int(nSaved));
+            continue;
+         }
+         Rcpp::NumericMatrix thisChainSamples(nSaved,nTracedParam);
+         Rcpp::CharacterVector thisChainRowNames;
+         for(size_t row=0; row<nSaved; row++) {
+            for(size_t col=0; col<nTracedParam; col++) {
+               double v = chains[c]->traces.get(row,col);
+               thisChainSamples(row,col) = v;
+               tracedSamples(firstRow+row,col) = v;
+            }
+            stackedRowNames.push_back(sampleCycleNames[row]);
+            thisChainRowNames.push_back(sampleCycleNames[row]);
+         }
+         firstRow += nSaved;
+         Rcpp::colnames(thisChainSamples) = sampleColNames;
+         Rcpp::rownames(thisChainSamples) = thisChainRowNames;
+         chainSamples.push_back(thisChainSamples,"chain"+std::to_string(c+1));
+      }
+      Rcpp::List traceFiles = Rcpp::List::create(Rcpp::Named("Files")=traceFileNames,
+               Rcpp::Named("Rows")=traceFileRows, Rcpp::Named("Precision")=(trace_float ? "float" : "double"),
+               Rcpp::Named("Params")=sampleColNames, Rcpp::Named("Cycles")=outputCycleNumbers);
+      if(!tracesInFiles) {
+         Rcpp::colnames(tracedSamples) = sampleColNames;
+         Rcpp::rownames(tracedSamples) = stackedRowNames;
+      }
       /* I couldn't get this colnames() and rownames() working, it gives a compiler error that the Rcpp::NumericMatrix
          can't be conveted to SEXP object - but online examples show this should work ...
          */
@@ -385,7 +342,65 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
 //      Rcpp::List tracedSamplesNames = Rcpp::List::create(sampleRowNames,sampleColNames);
 //      tracedSamples.attr("dimnames") = tracedSamplesNames;
 
-      // 4. "Residuals" table: compute residuals from Y.data and fitted value (par-vector in modelR).
+      // 4. "Convergence" table from the online convergence monitors, pooled over chains: ESS is summed,
+      // MCSE is for the pooled mean, and GewekeZ is the largest absolute value over chains.
+      Rcpp::NumericVector convESS(nTracedParam), convMCSE(nTracedParam), convGeweke(nTracedParam);
+      for(size_t col=0; col<nTracedParam; col++) {
+         double sumEss=0.0l, sumVar=0.0l, maxZ=0.0l;
+         size_t nTotal=0;
+         for(size_t c=0; c<chains.size(); c++) nTotal += chains[c]->monitor.n;
+         for(size_t c=0; c<chains.size(); c++) {
+            convergenceMonitor & mon = chains[c]->monitor;
+            double w = double(mon.n)/double(nTotal);
+            sumEss += mon.ess(col);
+            sumVar += w * w * mon.mcse(col) * mon.mcse(col);
+            if(std::abs(mon.gewekeZ(col)) > maxZ || std::isnan(mon.gewekeZ(col))) maxZ = std::abs(mon.gewekeZ(col));
+         }
+         convESS[col] = sumEss;
+         convMCSE[col] = std::sqrt(sumVar);
+         convGeweke[col] = maxZ;
+      }
+      Rcpp::DataFrame convergence = Rcpp::DataFrame::create
+              (Rcpp::Named("Param")=sampleColNames, Rcpp::Named("ESS")=convESS,
+              Rcpp::Named("MCSE")=convMCSE, Rcpp::Named("GewekeZ")=convGeweke);
+
+      // 5. "Timing" table: wall time per model term and phase, summed over chains, with a last row for
+      // the whole cycle (of the first chain). PerSec is calls per second, for the last row cycles/sec.
+      Rcpp::CharacterVector timTerm, timPhase;
+      Rcpp::NumericVector timCalls, timSeconds, timNobs, timNsPerObs, timPerSec;
+      for(size_t tm=0; tm<chains[0]->timers.size(); tm++) {
+         double calls=0.0l, seconds=0.0l;
+         for(size_t c=0; c<chains.size(); c++) {
+            calls += double(chains[c]->timers[tm].calls);
+            seconds += chains[c]->timers[tm].seconds;
+         }
+         if(calls==0) continue;
+         double nobs = double(chains[0]->timers[tm].nobs);
+         timTerm.push_back(chains[0]->timers[tm].term);
+         timPhase.push_back(chains[0]->timers[tm].phase);
+         timCalls.push_back(calls);
+         timSeconds.push_back(seconds);
+         timNobs.push_back(nobs);
+         timNsPerObs.push_back( (nobs>0) ? 1.0e9*seconds/(calls*nobs) : NA_REAL);
+         timPerSec.push_back( (seconds>0) ? calls/seconds : NA_REAL);
+      }
+      {
+         double cycles = double(chains[0]->lastCycle - chains[0]->startCycle);
+         double seconds = chains[0]->runSeconds;
+         timTerm.push_back("all");
+         timPhase.push_back("cycle");
+         timCalls.push_back(cycles);
+         timSeconds.push_back(seconds);
+         timNobs.push_back(double(nResiduals));
+         timNsPerObs.push_back( (cycles>0) ? 1.0e9*seconds/(cycles*double(nResiduals)) : NA_REAL);
+         timPerSec.push_back( (seconds>0) ? cycles/seconds : NA_REAL);
+      }
+      Rcpp::DataFrame timing = Rcpp::DataFrame::create
+              (Rcpp::Named("Term")=timTerm, Rcpp::Named("Phase")=timPhase, Rcpp::Named("Calls")=timCalls,
+              Rcpp::Named("Seconds")=timSeconds, Rcpp::Named("Nobs")=timNobs,
+              Rcpp::Named("nsPerObs")=timNsPerObs, Rcpp::Named("PerSec")=timPerSec);
+
+      // 6. "Residuals" table: compute residuals from Y.data and fitted value (par-vector in modelR).
       // The 'resid' in modelR cannot be used because that one is a sampled state, not a posterior mean.
       // Need to think about modifications for non-linear models, then residual may also need to be stored
       // and averaged because it is more difficult to computer from the Y and fitted value?
@@ -405,17 +420,25 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
       if(Rbayz::Messages.size()>0) 
          result.push_back(Rbayz::Messages,"Messages");
       result.push_back(parInfo,"Parameters");
-      result.push_back(tracedSamples,"Samples");
+      if(tracesInFiles) {
+         result.push_back(traceFiles,"TraceFiles");
+      }
+      else {
+         result.push_back(tracedSamples,"Samples");
+         if(nchains>1) result.push_back(chainSamples,"ChainSamples");
+      }
+      result.push_back(convergence,"Convergence");
       result.push_back(estimates,"Estimates");
       result.push_back(residuals,"Residuals");
       result.push_back(Rbayz::RunInfo,"Runinfo");
+      result.push_back(timing,"Timing");
       lastDone="Filling return list";
       if (verbose>1) Rcpp::Rcout << "Ready filling return list\n";
 
       // clean-up and normal termination
       // ------------------
-      if(modelR != 0) delete modelR;
-      for(size_t i=0; i<model.size(); i++) delete model[i];
+      for(size_t c=0; c<chains.size(); c++) delete chains[c];
+      Rbayz::modelEnv = Rcpp::Environment::global_env();   // release the caller's frame
       return(result);
 
    } // end try{}
@@ -433,14 +456,16 @@ Rcpp::List rbayz_cpp(Rcpp::Formula modelFormula, SEXP VE, Rcpp::DataFrame inputD
    catch (...) {
       Rbayz::Messages.push_back("An unknown error occured in bayz after: "+lastDone);
    }
+   // clean-up of the chains that were built (also closes their trace and sample files)
+   for(size_t c=0; c<chains.size(); c++) delete chains[c];
+   chains.clear();
+   Rbayz::modelEnv = Rcpp::Environment::global_env();
    // Build a return list that only has the error messages list.
    Rcpp::List result = Rcpp::List::create();
    result.push_back(Rbayz::Messages.size(),"nError");
    result.push_back(Rbayz::Messages,"Messages");
    Rcpp::Rcout << "Bayz finished with (last) error: " << Rbayz::Messages[Rbayz::Messages.size()-1] << std::endl;
    Rcpp::Rcout << "There may be more messages or errors - use summary() or check <output>$Errors to see all" << std::endl;
-//   if(modelR != 0) delete modelR;
-//   for(size_t i=0; i<model.size(); i++) delete model[i];
    return(result);
 
 }  // end rbayz_cpp main function
@@ -0,0 +1,130 @@
+//
+//  rbayzRNG.cpp
+//
+
+#include "rbayzRNG.h"
+#include <cstring>
+#include "checkpointTools.h"
+
+rbayzRNG::rbayzRNG(uint64_t seed, uint64_t stream) : seed(seed), stream(stream) {
+}
+
+void rbayzRNG::philox(uint64_t ctr, uint32_t out[4]) {
+   uint32_t c0 = uint32_t(ctr), c1 = uint32_t(ctr >> 32);
+   uint32_t c2 = uint32_t(stream), c3 = uint32_t(stream >> 32);
+   uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+   for(int round=0; round<10; round++) {
+      uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+      uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+      uint32_t hi0 = uint32_t(p0 >> 32), lo0 = uint32_t(p0);
+      uint32_t hi1 = uint32_t(p1 >> 32), lo1 = uint32_t(p1);
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+   }
+   out[0]=c0; out[1]=c1; out[2]=c2; out[3]=c3;
+}
+
+// Every Philox block gives 2 doubles in (0,1) using 53 bits; the +0.5 keeps them away
+// from 0 and 1 so that log(u) is always finite.
+void rbayzRNG::refillUniform() {
+   uint32_t r[4];
+   for(size_t i=0; i<rngBufferSize; i+=2) {
+      philox(counter++, r);
+      uint64_t u0 = (uint64_t(r[0]) << 21) ^ (r[1] >> 11);
+      uint64_t u1 = (uint64_t(r[2]) << 21) ^ (r[3] >> 11);
+      unifBuf[i]   = (double(u0 & 0x1FFFFFFFFFFFFFull) + 0.5) / 9007199254740992.0;
+      unifBuf[i+1] = (double(u1 & 0x1FFFFFFFFFFFFFull) + 0.5) / 9007199254740992.0;
+   }
+   unifPos=0;
+}
+
+// Normals by Box-Muller on pairs of uniforms; uniforms are taken from the uniform buffer.
+void rbayzRNG::refillNormal() {
+   const double twopi = 6.283185307179586;
+   for(size_t i=0; i<rngBufferSize; i+=2) {
+      if(unifPos >= rngBufferSize-1) refillUniform();
+      double r = std::sqrt(-2.0 * std::log(unifBuf[unifPos]));
+      double theta = twopi * unifBuf[unifPos+1];
+      unifPos += 2;
+      normBuf[i] = r * std::cos(theta);
+      normBuf[i+1] = r * std::sin(theta);
+   }
+   normPos=0;
+}
+
+// Gamma(shape, scale=1) using Marsaglia and Tsang (2000); for shape < 1 using the boost
+// gamma(shape+1) * u^(1/shape).
+double rbayzRNG::rgamma(double shape) {
+   if(expectation) return shape;
+   if(shape < 1.0) {
+      double u = runif(0.0, 1.0);
+      return rgamma(shape + 1.0) * std::pow(u, 1.0/shape);
+   }
+   double d = shape - 1.0/3.0;
+   double c = 1.0/std::sqrt(9.0*d);
+   while(true) {
+      double x, v;
+      do {
+         x = rnorm(0.0, 1.0);
+         v = 1.0 + c*x;
+      } while (v <= 0.0);
+      v = v*v*v;
+      double u = runif(0.0, 1.0);
+      if(u < 1.0 - 0.0331*x*x*x*x) return d*v;
+      if(std::log(u) < 0.5*x*x + d*(1.0 - v + std::log(v))) return d*v;
+   }
+}
+
+void rbayzRNG::fillUniform(double* x, size_t n) {
+   size_t done=0;
+   while(done < n) {
+      if(unifPos == rngBufferSize) refillUniform();
+      size_t take = rngBufferSize - unifPos;
+      if(take > n-done) take = n-done;
+      std::memcpy(x+done, unifBuf+unifPos, take*sizeof(double));
+      unifPos += take;
+      done += take;
+   }
+}
+
+void rbayzRNG::fillNormal(double* x, size_t n) {
+   size_t done=0;
+   while(done < n) {
+      if(normPos == rngBufferSize) refillNormal();
+      size_t take = rngBufferSize - normPos;
+      if(take > n-done) take = n-done;
+      std::memcpy(x+done, normBuf+normPos, take*sizeof(double));
+      normPos += take;
+      done += take;
+   }
+}
+
+void rbayzRNG::fillChisq(double* x, size_t n, double df) {
+   for(size_t i=0; i<n; i++) x[i] = rchisq(df);
+}
+
+void rbayzRNG::saveState(FILE* f) {
+   writeState(f, &seed, 1);
+   writeState(f, &stream, 1);
+   writeState(f, &counter, 1);
+   writeState(f, &unifPos, 1);
+   writeState(f, &normPos, 1);
+   writeState(f, unifBuf, rngBufferSize);
+   writeState(f, normBuf, rngBufferSize);
+}
+
+void rbayzRNG::loadState(FILE* f) {
+   readState(f, &seed, 1);
+   readState(f, &stream, 1);
+   readState(f, &counter, 1);
+   readState(f, &unifPos, 1);
+   readState(f, &normPos, 1);
+   readState(f, unifBuf, rngBufferSize);
+   readState(f, normBuf, rngBufferSize);
+   if(unifPos > rngBufferSize || normPos > rngBufferSize)
+      throw generalRbayzError("Error reading checkpoint file: file is damaged");
+}
@@ -0,0 +1,81 @@
+//
+//  rbayzRNG.h
+//  Random number generator used in the samplers. R's own generator (R::rnorm, R::runif, etc.)
+//  is not thread-safe, and cannot be used when chains run in parallel threads. Therefore every
+//  chain has its own rbayzRNG object. The sampling code does not need to know which chain it is
+//  running in: it retrieves the generator of the running chain through the thread_local pointer
+//  Rbayz::rng (see Rbayz.h), which is set by the chain at the start of running.
+//
+//  The generator is the counter-based Philox4x32-10 (Salmon et al. 2011): random numbers are a
+//  function of a key and a counter, where the key is a seed (drawn from R's generator, so that
+//  set.seed() in R makes a run reproducible) and the high half of the counter is a stream number.
+//  Streams with different numbers are independent and every stream gives the same sequence
+//  no matter which thread runs it, or in which order threads are scheduled.
+//  Uniforms and normals are generated in blocks of rngBufferSize in internal buffers, single
+//  draws take the next number from the buffer; fillUniform() and fillNormal() give batches of
+//  random numbers directly from the buffers.
+//  With expectation=true (method "VB") the generator returns expectations instead of random draws:
+//  rnorm gives the mean, rchisq the df and rgamma the shape, so that the samplers make deterministic
+//  mean-field updates (see mcmcChain::runVB).
+//
+
+#ifndef rbayzRNG_h
+#define rbayzRNG_h
+
+#include <stdint.h>
+#include <cstddef>
+#include <cmath>
+#include <stdio.h>
+
+#define rngBufferSize 256
+
+class rbayzRNG {
+
+public:
+
+   rbayzRNG(uint64_t seed, uint64_t stream=0);
+   ~rbayzRNG() { }
+
+   double rnorm(double mean, double sd) {
+      if(expectation) return mean;
+      if(normPos == rngBufferSize) refillNormal();
+      return mean + sd * normBuf[normPos++];
+   }
+
+   double runif(double a, double b) {
+      if(unifPos == rngBufferSize) refillUniform();
+      return a + (b-a) * unifBuf[unifPos++];
+   }
+
+   double rchisq(double df) {
+      if(expectation) return df;
+      return 2.0 * rgamma(df/2.0);
+   }
+
+   double rgamma(double shape);   // gamma with scale 1
+
+   // the complete state (including buffers) for checkpointing
+   void saveState(FILE* f);
+   void loadState(FILE* f);
+
+   // batched generation
+   void fillUniform(double* x, size_t n);
+   void fillNormal(double* x, size_t n);
+   void fillChisq(double* x, size_t n, double df);
+
+   bool expectation=false;
+
+   // seed and stream are set at construction, the counter and buffer positions are the state
+   uint64_t seed, stream, counter=0;
+   size_t unifPos=rngBufferSize, normPos=rngBufferSize;
+   double unifBuf[rngBufferSize];
+   double normBuf[rngBufferSize];
+
+   // Philox4x32-10 block function: 4 random 32-bit integers for counter 'ctr' of this stream
+   void philox(uint64_t ctr, uint32_t out[4]);
+   void refillUniform();
+   void refillNormal();
+
+};
+
+#endif /* rbayzRNG_h */
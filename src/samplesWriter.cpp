@@ -0,0 +1,104 @@
+//
+//  samplesWriter.cpp
+//
+
+#include <cstring>
+#include "samplesWriter.h"
+#include "rbayzExceptions.h"
+#include "checkpointTools.h"
+
+samplesWriter::samplesWriter(std::string fileName, std::string name, std::vector<std::string> & labels,
+                             bool append) : writeError(false), bytesWritten(0) {
+   nelem = labels.size();
+   // chunks of about 4MB, but at least one cycle
+   chunkCycles = 524288 / (nelem > 0 ? nelem : 1);
+   if(chunkCycles < 1) chunkCycles = 1;
+   for(int b=0; b<2; b++) {
+      buffers[b].cycles.reserve(chunkCycles);
+      buffers[b].values.reserve(chunkCycles*nelem);
+   }
+   filling = &buffers[0];
+   file = fopen(fileName.c_str(), append ? "ab" : "wb");
+   if(file==0) throw generalRbayzError("Unable to open file " + fileName + " for writing samples");
+   if(append) {
+      fileSeek(file, 0, SEEK_END);
+      bytesWritten = fileTell(file);
+   }
+   else {
+      int len;
+      fwrite("RBZSMP01", 1, 8, file);
+      len = int(name.size());
+      fwrite(&len, sizeof(int), 1, file);
+      fwrite(name.c_str(), 1, name.size(), file);
+      int n = int(nelem);
+      fwrite(&n, sizeof(int), 1, file);
+      for(size_t i=0; i<nelem; i++) {
+         len = int(labels[i].size());
+         fwrite(&len, sizeof(int), 1, file);
+         fwrite(labels[i].c_str(), 1, labels[i].size(), file);
+      }
+      bytesWritten = fileTell(file);
+   }
+   writer = std::thread(&samplesWriter::writerLoop, this);
+}
+
+samplesWriter::~samplesWriter() {
+   flush();
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+      stopThread = true;
+   }
+   cv.notify_all();
+   if(writer.joinable()) writer.join();
+   if(file != 0) fclose(file);
+}
+
+void samplesWriter::add(int cycle, const double* values) {
+   if(writeError.load()) throw generalRbayzError("Error writing samples file");
+   filling->cycles.push_back(cycle);
+   filling->values.insert(filling->values.end(), values, values+nelem);
+   if(filling->cycles.size() >= chunkCycles) handOver();
+}
+
+// give the filled buffer to the writer thread, waiting if it is still busy with the other one
+void samplesWriter::handOver() {
+   std::unique_lock<std::mutex> lock(mtx);
+   cv.wait(lock, [this]{ return writing==0; });
+   writing = filling;
+   filling = (filling == &buffers[0]) ? &buffers[1] : &buffers[0];
+   lock.unlock();
+   cv.notify_all();
+}
+
+int64_t samplesWriter::flush() {
+   if(!filling->cycles.empty()) handOver();
+   std::unique_lock<std::mutex> lock(mtx);
+   cv.wait(lock, [this]{ return writing==0; });
+   if(fflush(file) != 0) writeError = true;
+   return bytesWritten.load();
+}
+
+void samplesWriter::writerLoop() {
+   std::unique_lock<std::mutex> lock(mtx);
+   while(true) {
+      cv.wait(lock, [this]{ return writing!=0 || stopThread; });
+      if(writing==0 && stopThread) break;
+      chunk* c = writing;
+      lock.unlock();
+      writeChunk(c);
+      lock.lock();
+      writing = 0;
+      cv.notify_all();
+   }
+}
+
+void samplesWriter::writeChunk(chunk* c) {
+   int n = int(c->cycles.size());
+   bool ok = (fwrite(&n, sizeof(int), 1, file) == 1) &&
+             (fwrite(c->cycles.data(), sizeof(int), n, file) == size_t(n)) &&
+             (fwrite(c->values.data(), sizeof(double), c->values.size(), file) == c->values.size());
+   if(!ok) writeError = true;
+   bytesWritten += int64_t(sizeof(int)*(1+n) + sizeof(double)*c->values.size());
+   c->cycles.clear();
+   c->values.clear();
+}
@@ -0,0 +1,64 @@
+//
+//  samplesWriter.h
+//  Writing of samples files for parameters with the 'save' option, in a binary chunked format,
+//  by a background thread so that the MCMC does not wait for formatting and disk writes.
+//  Samples are collected in one buffer while the writer thread writes the other buffer (double
+//  buffering); the sampler only waits when both buffers are full. The error flag and byte count
+//  are atomic because the writer thread updates them outside the mutex.
+//  File format (native byte order, integers are 4 bytes):
+//   - "RBZSMP01" (8 characters)
+//   - name length and name of the parameter-vector, number of elements (nelem)
+//   - nelem times: label length and label
+//   - chunks, each with: number of cycles n, the n cycle numbers, and n x nelem doubles (by cycle)
+//  R function readSamples() reads these files.
+//
+
+#ifndef samplesWriter_h
+#define samplesWriter_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
+
+class samplesWriter {
+
+public:
+
+   // opens the file and starts the writer thread; with append=true the file exists and the header
+   // is not written again.
+   samplesWriter(std::string fileName, std::string name, std::vector<std::string> & labels, bool append);
+   ~samplesWriter();
+
+   void add(int cycle, const double* values);
+   // write everything collected and wait until it is on disk, returns the file size
+   int64_t flush();
+   bool failed() { return writeError.load(); }
+
+private:
+   struct chunk {
+      std::vector<int> cycles;
+      std::vector<double> values;
+   };
+   FILE* file=0;
+   size_t nelem=0, chunkCycles=1;
+   chunk buffers[2];
+   chunk* filling;
+   chunk* writing=0;        // non-zero when the writer thread has a chunk to write
+   bool stopThread=false;
+   std::atomic<bool> writeError;            // set by the writer thread, read by the sampler
+   std::atomic<int64_t> bytesWritten;
+   std::mutex mtx;
+   std::condition_variable cv;
+   std::thread writer;
+   void writerLoop();
+   void handOver();
+   void writeChunk(chunk* c);
+
+};
+
+#endif /* samplesWriter_h */
@@ -5,6 +5,7 @@
 #include "simpleFactor.h"
 #include "nameTools.h"
 #include "rbayzExceptions.h"
+#include "hashCoder.h"
 
 // ----------------- simpleFactor class --------------------
 
@@ -16,9 +17,14 @@
    of "unmatched levels" because "NA" will not be found in levelLabels.
 */
 
-// comparison function for lower_bound on pair<string,int> by first element only
-bool compare_pair_by_first(const std::pair<std::string, int> & a, const std::pair<std::string, int> & b) {
-    return a.first < b.first;
+// The rows of a character vector as CHARSXP pointers: R keeps one copy of every string in its
+// string cache, so equal strings (in the same encoding) have the same pointer and can be coded by
+// pointer without string compares. The pointers are taken here in the main thread.
+static std::vector<SEXP> charsxpPointers(Rcpp::CharacterVector & Rstrings) {
+   std::vector<SEXP> strings(Rstrings.size());
+   for (size_t row = 0; row < strings.size(); row++)
+      strings[row] = STRING_ELT(Rstrings, row);
+   return strings;
 }
 
 simpleFactor::simpleFactor(Rcpp::RObject col, std::string inp_name) : simpleIntVector()
@@ -30,12 +36,12 @@ simpleFactor::simpleFactor(Rcpp::RObject col, std::string inp_name) : simpleIntV
       - if input is R factor, it is directly convertable to integer vector that can be
         copied in the 'data' using initWith, but R starts coding from 1 so it needs to
         subtract 1 to code from 0, and NAs will be large negative number and are repaired later.
-      - if input is an R character vector, converting to strings would convert NAs to string "NA",
-        but I avoid that by building a map with the input strings that are not NA. Then later
-        NA is added as last level, and it's level-codes are inserted as the last 'lev' value.
-      - if input is an R integer vector I build a map of <int,int> so the sorting is nicer (as
-        strings it would give the ugly sorting with "10" before "2"); treatment of NAs is like for
-        a character vector.
+      - if input is an R character vector, the strings that are not NA are coded with a hash table
+        (see hashCoder.h) on their CHARSXP pointers, the distinct strings are then sorted to make
+        the levels. NA is added as last level.
+      - if input is an R integer vector the values are coded with a hash table and the distinct
+        values sorted as integers (as strings it would give the ugly sorting with "10" before "2");
+        treatment of NAs is like for a character vector.
       - logical vector input can be directly converted to interger and copied in 'data' using
         initWith, NAs will become large negative numbers and needs NA treatment like the first case.
         The IntegerVector will have 0 for false, 1 for true, so it is immediate in C base-0 coding.
@@ -67,67 +73,42 @@ simpleFactor::simpleFactor(Rcpp::RObject col, std::string inp_name) : simpleIntV
    else if (Rcpp::is<Rcpp::IntegerVector>(col) && !Rf_isMatrix(col))
    {
       Rcpp::IntegerVector Rtempvec = Rcpp::as<Rcpp::IntegerVector>(col);
-      Rcpp::LogicalVector missing = Rcpp::is_na(Rtempvec);
-      std::map<int, int> unique_levels;
-      for (int i = 0; i < Rtempvec.size(); i++)
-      { // build map with non-NA values
-         if (!missing[i])
-            unique_levels[Rtempvec[i]];
-      }
-      std::map<int, int>::iterator p;
-      size_t lev = 0; // Code the merged levels in the map
-      for (p = unique_levels.begin(); p != unique_levels.end(); p++)
-         p->second = lev++;
-      initWith(Rtempvec.size(), 0.0l);
-      for (int i = 0; i < Rtempvec.size(); i++)
-      { // code the data
-         if (missing[i])
-            data[i] = lev;
-         else
-         {
-            p = unique_levels.find(Rtempvec[i]);
-            data[i] = p->second;
-         }
-      }
+      initWith(Rtempvec.size(), 0);
+      std::vector<int> values;   // distinct values in order of appearance
+      hashCodeColumn<int, hashInt>(Rtempvec.begin(), nelem, NA_INTEGER, data, values);
+      std::vector<int> sorted_values(values);
+      std::sort(sorted_values.begin(), sorted_values.end());
+      std::vector<int> newCode(values.size());
+      for (size_t c = 0; c < values.size(); c++)
+         newCode[c] = int(std::lower_bound(sorted_values.begin(), sorted_values.end(), values[c]) - sorted_values.begin());
+      bool anyNA = recodeColumn(data, nelem, newCode, int(sorted_values.size()));
       // fill labels vector
-      labels.reserve(lev);
-      for (p = unique_levels.begin(); p != unique_levels.end(); p++)
-         labels.push_back(std::to_string(p->first));
-      if (sum(missing) > 0)
+      labels.reserve(sorted_values.size() + 1);
+      for (size_t lev = 0; lev < sorted_values.size(); lev++)
+         labels.push_back(std::to_string(sorted_values[lev]));
+      if (anyNA)
          labels.push_back("NA");
    }
    else if (Rcpp::is<Rcpp::CharacterVector>(col) && !Rf_isMatrix(col))
    {
       Rcpp::CharacterVector Rtempvec = Rcpp::as<Rcpp::CharacterVector>(col);
-      Rcpp::LogicalVector missing = Rcpp::is_na(Rtempvec);
-      std::vector<std::string> Ctempvec;
-      CharVec2cpp(Ctempvec, Rtempvec);
-      std::map<std::string, int> unique_levels;
-      for (size_t i = 0; i < Ctempvec.size(); i++)
-      { // build map with non-NA values
-         if (!missing[i])
-            unique_levels[Ctempvec[i]];
-      }
-      std::map<std::string, int>::iterator p;
-      size_t lev = 0; // Code the merged levels in the map
-      for (p = unique_levels.begin(); p != unique_levels.end(); p++)
-         p->second = lev++;
-      initWith(Ctempvec.size(), 0);
-      for (size_t i = 0; i < Ctempvec.size(); i++)
-      { // code the data
-         if (missing[i])
-            data[i] = lev;
-         else
-         {
-            p = unique_levels.find(Ctempvec[i]);
-            data[i] = p->second;
-         }
-      }
-      // fill labels vector
-      labels.reserve(lev);
-      for (p = unique_levels.begin(); p != unique_levels.end(); p++)
-         labels.push_back(p->first);
-      if (sum(missing) > 0)
+      std::vector<SEXP> strings = charsxpPointers(Rtempvec);
+      initWith(strings.size(), 0);
+      std::vector<SEXP> distinct;   // distinct CHARSXPs in order of appearance
+      hashCodeColumn<SEXP, hashPointer>(strings.data(), nelem, NA_STRING, data, distinct);
+      // the same string can still come in more than one CHARSXP (different encoding flags), sorting
+      // and removing duplicates of the strings merges these.
+      std::vector<std::string> distinct_strings(distinct.size());
+      for (size_t c = 0; c < distinct.size(); c++)
+         distinct_strings[c] = CHAR(distinct[c]);
+      labels = distinct_strings;
+      std::sort(labels.begin(), labels.end());
+      labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+      std::vector<int> newCode(distinct.size());
+      for (size_t c = 0; c < distinct.size(); c++)
+         newCode[c] = int(std::lower_bound(labels.begin(), labels.end(), distinct_strings[c]) - labels.begin());
+      bool anyNA = recodeColumn(data, nelem, newCode, int(labels.size()));
+      if (anyNA)
          labels.push_back("NA");
    }
    else if (Rcpp::is<Rcpp::LogicalVector>(col) && !Rf_isMatrix(col))
@@ -154,103 +135,87 @@ simpleFactor::simpleFactor(Rcpp::RObject col, std::string inp_name) : simpleIntV
 }
 
 // Constructor version with supplied level labels - so far the levels / labels coming from a kernel.
-// This uses a bit different strategy to first get all factor data as strings, then code according to levelLabels.
+// This uses a bit different strategy to first code the distinct values in the data, and then match these as
+// strings to the levelLabels.
 // The coding will be in the order of levelLabels.
 simpleFactor::simpleFactor(Rcpp::RObject col, std::string name, std::vector<std::string> levelLabels, 
       std::string kernel_name) : simpleIntVector()
    {
 
-   // get the factor from the data as vector<string> for all input types (except boolean?)
-   std::vector<std::string> temp_fac_strings;
+   // Code the rows with the hash coder (see hashCoder.h), giving the distinct values in order of
+   // appearance, and get these distinct values as strings; NA (code -1) is matched as string "NA".
+   // I think IntegerVector and CharacterVector work the same as before, where
+   // Rcpp::as<Rcpp:CharacterVector> converted integers to strings.
+   std::vector<std::string> distinct_strings;
    if (Rf_isFactor(col))
    {
       Rcpp::IntegerVector temp_fac_Rlevs = Rcpp::as<Rcpp::IntegerVector>(col);
-      Rcpp::LogicalVector missing = Rcpp::is_na(temp_fac_Rlevs);
       Rcpp::CharacterVector templabels = col.attr("levels");
-      temp_fac_strings.resize(temp_fac_Rlevs.size());
-      for (size_t row = 0; row < unsigned(temp_fac_Rlevs.size()); row++) {
-         if (missing[row])
-            temp_fac_strings[row] = "NA";
-         else
-            temp_fac_strings[row] = Rcpp::as<std::string>(templabels[temp_fac_Rlevs[row] - 1]); // R factor levels from 1! 
-      }
+      initWith(temp_fac_Rlevs.size(), 0);
+      std::vector<int> distinct;
+      hashCodeColumn<int, hashInt>(temp_fac_Rlevs.begin(), nelem, NA_INTEGER, data, distinct);
+      for (size_t c = 0; c < distinct.size(); c++)
+         distinct_strings.push_back(Rcpp::as<std::string>(templabels[distinct[c] - 1])); // R factor levels from 1!
+   }
+   else if (Rcpp::is<Rcpp::IntegerVector>(col) && !Rf_isMatrix(col)) {
+      Rcpp::IntegerVector Rtempvec = Rcpp::as<Rcpp::IntegerVector>(col);
+      initWith(Rtempvec.size(), 0);
+      std::vector<int> distinct;
+      hashCodeColumn<int, hashInt>(Rtempvec.begin(), nelem, NA_INTEGER, data, distinct);
+      for (size_t c = 0; c < distinct.size(); c++)
+         distinct_strings.push_back(std::to_string(distinct[c]));
    }
-   // I think IntegerVector and CharacterVector can be treated the same way here because the
-   // Rcpp::as<Rcpp:CharacterVector> will convert integers to strings automatically.
-   else if ( (Rcpp::is<Rcpp::IntegerVector>(col) || Rcpp::is<Rcpp::CharacterVector>(col) ) && !Rf_isMatrix(col)) {
+   else if (Rcpp::is<Rcpp::CharacterVector>(col) && !Rf_isMatrix(col)) {
       Rcpp::CharacterVector Rcpp_strings = Rcpp::as<Rcpp::CharacterVector>(col);
-      Rcpp::LogicalVector missing = Rcpp::is_na(Rcpp_strings);
-      temp_fac_strings.resize(Rcpp_strings.size());
-      for (size_t row = 0; row < unsigned(Rcpp_strings.size()); row++) {
-         if (missing[row])
-            temp_fac_strings[row] = "NA";
-         else
-            temp_fac_strings[row] = Rcpp::as<std::string>(Rcpp_strings[row]);
-      }
+      std::vector<SEXP> strings = charsxpPointers(Rcpp_strings);
+      initWith(strings.size(), 0);
+      std::vector<SEXP> distinct;
+      hashCodeColumn<SEXP, hashPointer>(strings.data(), nelem, NA_STRING, data, distinct);
+      for (size_t c = 0; c < distinct.size(); c++)
+         distinct_strings.push_back(CHAR(distinct[c]));
    }
    else if (Rcpp::is<Rcpp::LogicalVector>(col) && !Rf_isMatrix(col)) {
       Rcpp::IntegerVector Rtempvec = Rcpp::as<Rcpp::IntegerVector>(col);
-      Rcpp::LogicalVector missing = Rcpp::is_na(Rtempvec);
-      temp_fac_strings.resize(Rtempvec.size());
-      for (size_t row = 0; row < unsigned(Rtempvec.size()); row++) {
-         if (missing[row])
-            temp_fac_strings[row] = "NA";
-         else if (Rtempvec[row] == 0)
-            temp_fac_strings[row] = "FALSE";
-         else
-            temp_fac_strings[row] = "TRUE";
-      }
+      initWith(Rtempvec.size(), 0);
+      std::vector<int> distinct;
+      hashCodeColumn<int, hashInt>(Rtempvec.begin(), nelem, NA_INTEGER, data, distinct);
+      for (size_t c = 0; c < distinct.size(); c++)
+         distinct_strings.push_back((distinct[c] == 0) ? "FALSE" : "TRUE");
    }
    else {
       throw generalRbayzError("Variable/data column is not convertable to a factor: " + name);
    }
 
-   // Now code the factor data according to the supplied levelLabels. Here instead of a map
-   // use a sorted vector and lower_bound to find levels. The map was useful when expecting
-   // (maybe many) duplicates, but the levelLabels should be unique already. Then it is easy
-   // to just make a sorted version for searching.
-   // Note: the final coding remains in the levelLabels order, not the sorted order.
-   // Note: to find back the entry in levelLabels, a vector of pairs is needed which holds the
-   // label and the original index. 
-   std::vector< std::pair<std::string,int> > sorted_levels_pairs(levelLabels.size());
+   // Now code the factor data according to the supplied levelLabels: a hash table on the labels
+   // is used to look up every distinct string once, and the rows are recoded with the result.
+   // Note: the final coding remains in the levelLabels order; labelIndex has the position in
+   // levelLabels for every code of the label hash table (the first one if a label is repeated).
+   hashCoder<std::string, hashString> labelCoder(levelLabels.size());
+   std::vector<int> labelIndex;
    for (size_t i = 0; i < levelLabels.size(); i++) {
-      sorted_levels_pairs[i] = std::make_pair(levelLabels[i], i);
+      if (labelCoder.code(levelLabels[i]) == int(labelIndex.size()))
+         labelIndex.push_back(int(i));
    }
-   std::sort(sorted_levels_pairs.begin(), sorted_levels_pairs.end());
-   
-   // Initialize data vector - temp_fac_strings is the strings (and size) found in the data
-   initWith(temp_fac_strings.size(), 0);
-   
    std::vector<std::string> unmatched_levels; // to store any unmatched levels
-   for(size_t i=0; i< temp_fac_strings.size(); i++) {
-      std::vector< std::pair<std::string,int> >::iterator it;
-      // Create a temporary pair for searching
-      std::pair<std::string,int> search_pair = std::make_pair(temp_fac_strings[i], 0);
-      it = std::lower_bound(sorted_levels_pairs.begin(), sorted_levels_pairs.end(), search_pair, compare_pair_by_first);
-      if( it == sorted_levels_pairs.end() || it->first != temp_fac_strings[i] ) {
-         unmatched_levels.push_back( temp_fac_strings[i] );
-      }
-      else {
-         data[i] = it->second;  // code according to original levelLabels order
+   std::vector<int> newCode(distinct_strings.size());
+   for (size_t c = 0; c < distinct_strings.size(); c++) {
+      int code = labelCoder.find(distinct_strings[c]);
+      if (code < 0) {
+         unmatched_levels.push_back(distinct_strings[c]);
+         newCode[c] = 0;
       }
+      else
+         newCode[c] = labelIndex[code];
    }
+   int naCode = labelCoder.find("NA");
+   bool anyNA = recodeColumn(data, nelem, newCode, (naCode < 0) ? 0 : labelIndex[naCode]);
+   if (anyNA && naCode < 0)
+      unmatched_levels.push_back("NA");
 
    // if any unmatched levels, throw error
-   if( unmatched_levels.size() > 0 ) {
-      Rbayz::Messages.push_back("There are levels in factor " + name +
-         " that cannot be matched to rownames of the kernel " + kernel_name + ":");
-      size_t nshow = std::min( unmatched_levels.size(), size_t(10) );
-      std::string s;
-      for(size_t i=0; i< nshow; i++) {
-         s += unmatched_levels[i] + " ";
-      }
-      if ( unmatched_levels.size() > nshow ) {
-         s += " [+ " + std::to_string(unmatched_levels.size() - nshow) + " more]";
-      }
-      Rbayz::Messages.push_back(s);
-      Rbayz::needStop = true;
-      throw generalRbayzError("Error matching kernel to factor levels - see messages output");
-   }
+   if( unmatched_levels.size() > 0 )
+      stopUnmatchedLevels("There are levels in factor " + name + " that cannot be matched to rownames of the kernel "
+                          + kernel_name + ":", unmatched_levels, "Error matching kernel to factor levels - see messages output");
 
    // if all OK, labels of the factor are the same (and in same order) as the supplied levelLabels
    // - but it will be normal that some levels have not observations in the data.
@@ -46,6 +46,60 @@ void simpleMatrix::initWith(Rcpp::NumericMatrix M) {
    initWith(M, M.ncol());
 }
 
+// Non-owning initialisation: data0 points in the memory of the R matrix and only the column
+// pointers are allocated. The Rcpp object is stored so that R keeps the memory protected.
+void simpleMatrix::borrowFrom(Rcpp::NumericMatrix M) {
+   if (nrow> 0 || ncol>0 ) {
+      throw(generalRbayzError("Attempted re-init or re-alloc in simpleMatrix"));
+   }
+   if (M.nrow() <= 0 || M.ncol() <= 0) {
+      throw(generalRbayzError("Zero or negative sizes in initialisation in simpleMatrix"));
+   }
+   borrowedObject = M;
+   data0 = &M[0];
+   nrow = M.nrow(); ncol = M.ncol();
+   data = new double*[ncol];
+   setColumnPointers();
+   borrowed = true;
+}
+
+// Replace a borrowed matrix by an own copy of the data, that can then be modified.
+void simpleMatrix::makeOwnCopy() {
+   if(!borrowed) return;
+   double* ownData = new double[nrow*ncol];
+   std::copy(data0, data0+nrow*ncol, ownData);
+   data0 = ownData;
+   setColumnPointers();
+   borrowedObject = Rcpp::NumericMatrix();
+   borrowed = false;
+}
+
+// Change the storage to float, optionally subtracting an offset per column (e.g. to store centered
+// data, which keeps more precision in float). The double data is deleted (or released when borrowed).
+void simpleMatrix::convertToFloat(const double* colOffset) {
+   if(useFloat || nrow==0 || ncol==0) return;
+   fdata0 = new float[nrow*ncol];
+   fdata  = new float*[ncol];
+   for(size_t col=0; col<ncol; col++) {
+      fdata[col] = fdata0 + col*nrow;
+      double offset = (colOffset==0) ? 0.0l : colOffset[col];
+      for(size_t row=0; row<nrow; row++)
+         fdata[col][row] = float(data[col][row] - offset);
+   }
+   if(!borrowed) delete[] data0;
+   delete[] data;
+   data0 = 0;
+   data = 0;
+   borrowedObject = Rcpp::NumericMatrix();
+   borrowed = false;
+   useFloat = true;
+}
+
+void simpleMatrix::setColumnPointers() {
+   for(size_t i=0; i<ncol; i++)
+      data[i] = data0 + i*nrow;
+}
+
 // Swap contents of two matrices: the contents of this-> (object itself) are
 // swapped with content of matrix pointed to by other->. 
 void simpleMatrix::swap(simpleMatrix* other) {
@@ -53,20 +107,29 @@ void simpleMatrix::swap(simpleMatrix* other) {
    double* olddata0 = this->data0;
    size_t oldnrow   = this->nrow;
    size_t oldncol   = this->ncol;
+   bool oldborrowed = this->borrowed;
+   std::swap(this->fdata, other->fdata);
+   std::swap(this->fdata0, other->fdata0);
+   std::swap(this->useFloat, other->useFloat);
    this->data  = other->data;
    this->data0 = other->data0;
    this->nrow  = other->nrow;
    this->ncol  = other->ncol;
+   this->borrowed = other->borrowed;
    other->data = olddata;
    other->data0 = olddata0;
    other->nrow  = oldnrow;
    other->ncol  = oldncol;
+   other->borrowed = oldborrowed;
+   std::swap(this->borrowedObject, other->borrowedObject);
 }
 
 simpleMatrix::~simpleMatrix() {
    if(nrow>0 && ncol>0) { // or check for data and data0 to be zero
       delete[] data;
-      delete[] data0;
+      if(!borrowed) delete[] data0;
+      delete[] fdata;
+      delete[] fdata0;
    }
 }
 
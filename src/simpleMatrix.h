@@ -7,6 +7,11 @@
 //    or alternatively, ->data[col] is a pointer to the data of column `col`
 //  - constructor with sizes specifies number of rows first! (as usual, but opposite to retrieving of elements).
 //  - initWith can only be used after using the constructor with no arguments.
+//  - borrowFrom() makes a non-owning matrix that points directly in the (column-major) memory of an
+//    R matrix, without copying; the R object is kept in the simpleMatrix so that it stays protected.
+//    A borrowed matrix must not be modified, use makeOwnCopy() first when modification is needed.
+//  - convertToFloat() changes the storage to float (in fdata[col][row]) and releases the double data,
+//    computing code must then check useFloat and use fdata instead of data.
 // Note: the actual elements need to be accessed as object->data[] (column) or ->data[][] (element),
 //    at least the first one can be made more fancy by adding a function for operator[]?
 //
@@ -29,6 +34,9 @@ public:
    
    void initWith(Rcpp::NumericMatrix M, size_t useCol);
    void initWith(Rcpp::NumericMatrix M);
+   void borrowFrom(Rcpp::NumericMatrix M);
+   void makeOwnCopy();
+   void convertToFloat(const double* colOffset=0);
 
    void swap(simpleMatrix* other);
 
@@ -37,9 +45,15 @@ public:
    double* data0=0;
    double** data=0;
    size_t nrow=0,ncol=0;
+   bool borrowed=false;
+   float* fdata0=0;
+   float** fdata=0;
+   bool useFloat=false;
 
 private:
    void doalloc(size_t nr, size_t nc);
+   void setColumnPointers();
+   Rcpp::NumericMatrix borrowedObject;
 
 };
 
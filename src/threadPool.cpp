@@ -0,0 +1,69 @@
+//
+//  threadPool.cpp
+//
+
+#include "threadPool.h"
+
+// a short spin (in the order of microseconds) before waiting on the condition variables, only to
+// catch the start of the next column when columns follow quickly
+static const int spinCount = 200;
+
+threadPool::threadPool(size_t n) : nparts(n), generation(0), nDone(0) {
+   if(nparts < 1) nparts = 1;
+   for(size_t part=1; part < nparts; part++)
+      workers.push_back(std::thread(&threadPool::workerLoop, this, part));
+}
+
+threadPool::~threadPool() {
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+      stop = true;
+      generation++;
+   }
+   cvStart.notify_all();
+   for(size_t i=0; i < workers.size(); i++) workers[i].join();
+}
+
+void threadPool::run(const std::function<void(size_t)> & t) {
+   if(nparts == 1) {
+      t(0);
+      return;
+   }
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+      task = &t;
+      nDone = 0;
+      generation++;
+   }
+   cvStart.notify_all();
+   t(0);
+   for(int i=0; i < spinCount && nDone.load() < nparts-1; i++) std::this_thread::yield();
+   if(nDone.load() < nparts-1) {
+      std::unique_lock<std::mutex> lock(mtx);
+      cvDone.wait(lock, [this]{ return nDone.load() == nparts-1; });
+   }
+   task = 0;
+}
+
+// Every worker runs exactly one part per run(), and run() only returns after all workers reported
+// their part done, so a worker never sees a task of a previous run.
+void threadPool::workerLoop(size_t part) {
+   unsigned long seen = 0;
+   const std::function<void(size_t)>* t;
+   while(true) {
+      for(int i=0; i < spinCount && generation.load() == seen; i++) std::this_thread::yield();
+      {
+         std::unique_lock<std::mutex> lock(mtx);
+         cvStart.wait(lock, [this, seen]{ return generation.load() != seen; });
+         seen = generation.load();
+         if(stop) return;
+         t = task;
+      }
+      (*t)(part);
+      {
+         std::unique_lock<std::mutex> lock(mtx);
+         nDone++;
+      }
+      cvDone.notify_one();
+   }
+}
@@ -0,0 +1,47 @@
+//
+//  threadPool.h
+//  A small pool of persistent worker threads to run the loops over observations of one model term
+//  in parallel (rr() with the threads option). run(task) calls task(part) for part = 0..nparts-1,
+//  with part 0 in the calling thread and every other part in its own worker, and returns when all
+//  parts are done. The work is split in fixed parts so that the results (e.g. partial sums combined
+//  in order of the parts) do not depend on the timing of the threads.
+//  Workers spin shortly (a few hundred yields) before they sleep, because the tasks are short (one
+//  covariate column) and are started many times per cycle; the spin is kept short so that idle
+//  workers do not hold cores. Every chain has its own pools, so with nchains chains and threads=k
+//  up to nchains*k threads are running.
+//
+
+#ifndef threadPool_h
+#define threadPool_h
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class threadPool {
+
+public:
+
+   threadPool(size_t nparts);
+   ~threadPool();
+
+   void run(const std::function<void(size_t)> & task);
+   size_t size() { return nparts; }
+
+private:
+   size_t nparts;
+   std::vector<std::thread> workers;
+   std::mutex mtx;
+   std::condition_variable cvStart, cvDone;
+   const std::function<void(size_t)>* task=0;
+   std::atomic<unsigned long> generation;
+   std::atomic<size_t> nDone;
+   bool stop=false;
+   void workerLoop(size_t part);
+
+};
+
+#endif /* threadPool_h */
@@ -0,0 +1,145 @@
+//
+//  traceStore.cpp
+//
+
+#include <cstring>
+#include "traceStore.h"
+#include "checkpointTools.h"
+#include "rbayzExceptions.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+traceStore::~traceStore() {
+   closeSpill(nrow);
+}
+
+void traceStore::init(size_t nr, size_t nc, bool flt, double memLimitMB, std::string spillFile) {
+   closeSpill(nrow);
+   nrow=nr; ncol=nc; useFloat=flt;
+   elemSize = useFloat ? sizeof(float) : sizeof(double);
+   fileName = spillFile;
+   rowBuffer.resize(ncol*elemSize);
+   double sizeMB = double(nrow)*double(ncol)*double(elemSize)/1048576.0;
+   spilled = (sizeMB > memLimitMB);
+   fdata.clear();
+   ddata.clear();
+   if(spilled) openSpill();
+   else if(useFloat) fdata.assign(nrow*ncol, 0.0f);
+   else ddata.assign(nrow*ncol, 0.0l);
+}
+
+// The file is opened without truncating, so that a resumed chain keeps the rows written before
+// the checkpoint; rows after the checkpoint are overwritten.
+void traceStore::openSpill() {
+   mappedBytes = nrow*ncol*elemSize;
+#ifndef _WIN32
+   fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+   if(fd < 0) throw generalRbayzError("Unable to open file " + fileName + " to store traced samples");
+   if(ftruncate(fd, off_t(mappedBytes)) != 0)
+      throw generalRbayzError("Unable to allocate file " + fileName + " to store traced samples");
+   if(mappedBytes > 0) {
+      void* p = mmap(0, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if(p == MAP_FAILED) throw generalRbayzError("Unable to map file " + fileName + " to store traced samples");
+      mapped = (char*) p;
+   }
+#else
+   spill = fopen(fileName.c_str(), "r+b");
+   if(spill==0) spill = fopen(fileName.c_str(), "w+b");
+   if(spill==0) throw generalRbayzError("Unable to open file " + fileName + " to store traced samples");
+#endif
+}
+
+void traceStore::closeSpill(size_t nrowUsed) {
+   size_t usedBytes = nrowUsed*ncol*elemSize;
+#ifndef _WIN32
+   if(mapped != 0) {
+      msync(mapped, mappedBytes, MS_SYNC);
+      munmap(mapped, mappedBytes);
+      mapped=0;
+   }
+   if(fd >= 0) {
+      if(ftruncate(fd, off_t(usedBytes)) != 0) { }   // cutting the file is not essential
+      close(fd);
+      fd=-1;
+   }
+#else
+   if(spill != 0) {
+      fclose(spill);
+      spill=0;
+   }
+#endif
+}
+
+void traceStore::setRow(size_t row, const double* x) {
+   if(!spilled) {
+      if(useFloat) {
+         float* dest = &fdata[row*ncol];
+         for(size_t col=0; col<ncol; col++) dest[col] = float(x[col]);
+      }
+      else std::memcpy(&ddata[row*ncol], x, ncol*sizeof(double));
+      return;
+   }
+   char* dest = (mapped != 0) ? mapped + row*ncol*elemSize : &rowBuffer[0];
+   if(useFloat) {
+      float* fdest = (float*) dest;
+      for(size_t col=0; col<ncol; col++) fdest[col] = float(x[col]);
+   }
+   else std::memcpy(dest, x, ncol*sizeof(double));
+   if(spill != 0) {
+      fileSeek(spill, int64_t(row*ncol*elemSize), SEEK_SET);
+      fwrite(dest, elemSize, ncol, spill);
+   }
+}
+
+double traceStore::get(size_t row, size_t col) {
+   if(!spilled) return useFloat ? double(fdata[row*ncol+col]) : ddata[row*ncol+col];
+   if(mapped != 0) {
+      const char* p = mapped + (row*ncol+col)*elemSize;
+      return useFloat ? double(*(const float*)p) : *(const double*)p;
+   }
+   if(spill == 0) return 0.0l;
+   fileSeek(spill, int64_t((row*ncol+col)*elemSize), SEEK_SET);
+   if(useFloat) {
+      float v=0.0f;
+      if(fread(&v, sizeof(float), 1, spill) != 1) return 0.0l;
+      return double(v);
+   }
+   double v=0.0l;
+   if(fread(&v, sizeof(double), 1, spill) != 1) return 0.0l;
+   return v;
+}
+
+void traceStore::finish(size_t nrowUsed) {
+   if(spilled) closeSpill(nrowUsed);
+}
+
+// In a checkpoint the rows in memory are written; a file is flushed and stays in place.
+void traceStore::saveState(FILE* f, size_t nrowUsed) {
+   writeState(f, &spilled, 1);
+   writeState(f, &useFloat, 1);
+   if(!spilled) {
+      if(useFloat) writeStateVector(f, fdata.data(), nrowUsed*ncol);
+      else writeStateVector(f, ddata.data(), nrowUsed*ncol);
+   }
+#ifndef _WIN32
+   else if(mapped != 0) msync(mapped, mappedBytes, MS_SYNC);
+#else
+   else if(spill != 0) fflush(spill);
+#endif
+}
+
+void traceStore::loadState(FILE* f, size_t nrowUsed) {
+   bool fileSpilled, fileFloat;
+   readState(f, &fileSpilled, 1);
+   readState(f, &fileFloat, 1);
+   if(fileSpilled != spilled || fileFloat != useFloat)
+      throw generalRbayzError("Resuming needs the same trace precision and memory limit as the checkpointed run");
+   if(!spilled) {
+      if(useFloat) readStateVector(f, fdata.data(), nrowUsed*ncol, "traced samples");
+      else readStateVector(f, ddata.data(), nrowUsed*ncol, "traced samples");
+   }
+}
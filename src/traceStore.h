@@ -0,0 +1,54 @@
+//
+//  traceStore.h
+//  Storage of the samples of traced parameters of one chain: a table of nrow (output cycles) by
+//  ncol (traced parameter elements), stored by row so that every save cycle writes one contiguous
+//  block. Values are stored as float (default) or double. When the table is larger than the
+//  memory limit it is stored in a file in the working directory, which is memory-mapped on POSIX
+//  systems (on Windows rows are written and read with stdio). A stored file remains after the run
+//  and is read from R with getSamples(), so large traces are not copied in memory.
+//  The file has no header: nrow x ncol values in float or double, row by row, in native byte order.
+//
+
+#ifndef traceStore_h
+#define traceStore_h
+
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <cstddef>
+
+class traceStore {
+
+public:
+
+   traceStore() { }
+   ~traceStore();
+
+   void init(size_t nrow, size_t ncol, bool useFloat, double memLimitMB, std::string spillFile);
+   void setRow(size_t row, const double* x);
+   double get(size_t row, size_t col);
+   // finish() flushes and cuts a file to the rows used, after this only get() can be used
+   void finish(size_t nrowUsed);
+   void saveState(FILE* f, size_t nrowUsed);
+   void loadState(FILE* f, size_t nrowUsed);
+
+   size_t nrow=0, ncol=0;
+   bool useFloat=true;
+   bool spilled=false;
+   std::string fileName="";
+
+private:
+   std::vector<float> fdata;
+   std::vector<double> ddata;
+   size_t elemSize=4;
+   char* mapped=0;
+   size_t mappedBytes=0;
+   int fd=-1;
+   FILE* spill=0;
+   std::vector<char> rowBuffer;
+   void openSpill();
+   void closeSpill(size_t nrowUsed);
+
+};
+
+#endif /* traceStore_h */